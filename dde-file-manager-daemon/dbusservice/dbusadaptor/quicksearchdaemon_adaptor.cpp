@@ -33,6 +33,20 @@ QuickSearchDaemonAdaptor::~QuickSearchDaemonAdaptor()
     // destructor
 }
 
+QDBusVariant QuickSearchDaemonAdaptor::beginSearch(const QDBusVariant &current_dir, const QDBusVariant &key_words)
+{
+    // handle method call com.deepin.filemanager.daemon.QuickSearchDaemon.beginSearch
+    QDBusVariant cursor;
+    QMetaObject::invokeMethod(parent(), "beginSearch", Q_RETURN_ARG(QDBusVariant, cursor), Q_ARG(QDBusVariant, current_dir), Q_ARG(QDBusVariant, key_words));
+    return cursor;
+}
+
+void QuickSearchDaemonAdaptor::cancelSearch(const QDBusVariant &cursor)
+{
+    // handle method call com.deepin.filemanager.daemon.QuickSearchDaemon.cancelSearch
+    QMetaObject::invokeMethod(parent(), "cancelSearch", Q_ARG(QDBusVariant, cursor));
+}
+
 QDBusVariant QuickSearchDaemonAdaptor::createCache()
 {
     // handle method call com.deepin.filemanager.daemon.QuickSearchDaemon.createCache
@@ -41,6 +55,14 @@ QDBusVariant QuickSearchDaemonAdaptor::createCache()
     return result;
 }
 
+QDBusVariant QuickSearchDaemonAdaptor::fetchSearchResult(const QDBusVariant &cursor, const QDBusVariant &max_count)
+{
+    // handle method call com.deepin.filemanager.daemon.QuickSearchDaemon.fetchSearchResult
+    QDBusVariant result;
+    QMetaObject::invokeMethod(parent(), "fetchSearchResult", Q_RETURN_ARG(QDBusVariant, result), Q_ARG(QDBusVariant, cursor), Q_ARG(QDBusVariant, max_count));
+    return result;
+}
+
 void QuickSearchDaemonAdaptor::fileWereCreated(const QDBusVariant &file_list)
 {
     // handle method call com.deepin.filemanager.daemon.QuickSearchDaemon.fileWereCreated
@@ -44,6 +44,19 @@ class QuickSearchDaemonAdaptor: public QDBusAbstractAdaptor
 "    <method name=\"whetherCacheCompletely\">\n"
 "      <arg direction=\"out\" type=\"v\" name=\"result\"/>\n"
 "    </method>\n"
+"    <method name=\"beginSearch\">\n"
+"      <arg direction=\"in\" type=\"v\" name=\"current_dir\"/>\n"
+"      <arg direction=\"in\" type=\"v\" name=\"key_words\"/>\n"
+"      <arg direction=\"out\" type=\"v\" name=\"cursor\"/>\n"
+"    </method>\n"
+"    <method name=\"fetchSearchResult\">\n"
+"      <arg direction=\"in\" type=\"v\" name=\"cursor\"/>\n"
+"      <arg direction=\"in\" type=\"v\" name=\"max_count\"/>\n"
+"      <arg direction=\"out\" type=\"v\" name=\"result\"/>\n"
+"    </method>\n"
+"    <method name=\"cancelSearch\">\n"
+"      <arg direction=\"in\" type=\"v\" name=\"cursor\"/>\n"
+"    </method>\n"
 "    <method name=\"fileWereCreated\">\n"
 "      <arg direction=\"in\" type=\"v\" name=\"file_list\"/>\n"
 "    </method>\n"
@@ -61,7 +74,10 @@ public:
 
 public: // PROPERTIES
 public Q_SLOTS: // METHODS
+    QDBusVariant beginSearch(const QDBusVariant &current_dir, const QDBusVariant &key_words);
+    void cancelSearch(const QDBusVariant &cursor);
     QDBusVariant createCache();
+    QDBusVariant fetchSearchResult(const QDBusVariant &cursor, const QDBusVariant &max_count);
     void fileWereCreated(const QDBusVariant &file_list);
     void fileWereDeleted(const QDBusVariant &file_list);
     void fileWereRenamed(const QDBusVariant &old_and_new);
@@ -76,6 +76,38 @@ QDBusVariant QuickSearchDaemon::search(const QDBusVariant &current_dir, const QD
     return dbus_var;
 }
 
+QDBusVariant QuickSearchDaemon::beginSearch(const QDBusVariant &current_dir, const QDBusVariant &key_words)
+{
+    QVariant path_var{ current_dir.variant() };
+    QVariant key_words_var{ key_words.variant() };
+
+    quint64 cursor{ DQuickSearch::instance()->beginSearch(path_var.toString(), key_words_var.toString()) };
+    QDBusVariant dbus_var{ QVariant{ cursor } };
+
+    return dbus_var;
+}
+
+QDBusVariant QuickSearchDaemon::fetchSearchResult(const QDBusVariant &cursor, const QDBusVariant &max_count)
+{
+    bool finished{ true };
+    bool interrupted{ false };
+    QList<QString> searched_result{ DQuickSearch::instance()->fetchSearchResult(cursor.variant().toULongLong(), max_count.variant().toInt(), &finished, &interrupted) };
+
+    QVariantMap result_map{};
+    result_map["files"] = QVariant{ searched_result };
+    result_map["finished"] = finished;
+    result_map["interrupted"] = interrupted;
+
+    QDBusVariant dbus_var{ QVariant{ result_map } };
+
+    return dbus_var;
+}
+
+void QuickSearchDaemon::cancelSearch(const QDBusVariant &cursor)
+{
+    DQuickSearch::instance()->cancelSearch(cursor.variant().toULongLong());
+}
+
 void QuickSearchDaemon::fileWereCreated(const QDBusVariant &file_list)
 {
     QVariant variant{ file_list.variant() };
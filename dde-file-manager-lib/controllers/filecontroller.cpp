@@ -80,6 +80,13 @@
 #endif
 #include "controllers/quicksearchdaemoncontroller.h"
 
+///###: the count of results fetched from quick-search-daemon at a time.
+#define QUICK_SEARCH_PAGE_SIZE 500
+///###: how many times a search is started again when the index was changed under it.
+#define QUICK_SEARCH_RESTART_LIMIT 3
+///###: milliseconds, the daemon does not wait for results, so wait here before asking for a pending page again.
+#define QUICK_SEARCH_FETCH_INTERVAL 50
+
 class DFMQDirIterator : public DDirIterator
 {
 public:
@@ -212,6 +219,14 @@ public:
 
     }
 
+    ~DFMQuickSearchDirIterator() override
+    {
+        ///###: the results which have not been fetched are useless now.
+        if (m_cursor != 0 && !m_finished) {
+            QuickSearchDaemonController::instance()->cancelSearch(m_cursor);
+        }
+    }
+
     DUrl next() override
     {
         QString searched_result{ m_searchedResult.takeFirst() };
@@ -231,14 +246,45 @@ public:
         ///###: if quick-search-daemon is not ready last time.
         ///###: check out the status of quick-searh-daemon again here.
         ///###: if ready, invoke quick-search-daemon to search files.
-        bool whether_cached_completely{ QuickSearchDaemonController::instance()->whetherCacheCompletely() };
+        if (!m_cachedFlag.load(std::memory_order_consume)) {
+            bool whether_cached_completely{ QuickSearchDaemonController::instance()->whetherCacheCompletely() };
+
+            if (!whether_cached_completely) {
+                return false;
+            }
 
-        if (whether_cached_completely && !m_cachedFlag.load(std::memory_order_consume)) {
-            m_searchedResult = QuickSearchDaemonController::instance()->search(m_pathForSearching, m_keyword);
+            m_cursor = QuickSearchDaemonController::instance()->beginSearch(m_pathForSearching, m_keyword);
+            m_finished = m_cursor == 0;
             m_cachedFlag.store(true, std::memory_order_release);
         }
 
-        return (m_cachedFlag.load(std::memory_order_consume) && !m_searchedResult.isEmpty());
+        ///###: the daemon searches in parallel, fetch the results page by page so that the first ones are shown quickly.
+        while (m_searchedResult.isEmpty() && !m_finished) {
+            bool interrupted{ false };
+            m_searchedResult = QuickSearchDaemonController::instance()->fetchSearchResult(m_cursor, QUICK_SEARCH_PAGE_SIZE, &m_finished, &interrupted);
+
+            if (m_searchedResult.isEmpty() && !m_finished) {
+                QThread::msleep(QUICK_SEARCH_FETCH_INTERVAL);
+                continue;
+            }
+
+            ///###: the index was changed during the search, search again and skip the files which were returned.
+            if (interrupted && m_restartCount++ < QUICK_SEARCH_RESTART_LIMIT) {
+                m_cursor = QuickSearchDaemonController::instance()->beginSearch(m_pathForSearching, m_keyword);
+                m_finished = m_cursor == 0;
+            }
+
+            for (QList<QString>::iterator itr = m_searchedResult.begin(); itr != m_searchedResult.end();) {
+                if (m_returnedResult.contains(*itr)) {
+                    itr = m_searchedResult.erase(itr);
+                } else {
+                    m_returnedResult.insert(*itr);
+                    ++itr;
+                }
+            }
+        }
+
+        return !m_searchedResult.isEmpty();
     }
 
     QString fileName() const override
@@ -268,6 +314,10 @@ public:
 private:
     mutable std::atomic<bool> m_cachedFlag{ false };
     mutable QList<QString> m_searchedResult{};
+    mutable quint64 m_cursor{ 0 };
+    mutable bool m_finished{ false };
+    mutable int m_restartCount{ 0 };
+    mutable QSet<QString> m_returnedResult{};
     QString m_pathForSearching{};
     QString m_keyword;
     QFileInfo currentFileInfo;
@@ -309,6 +359,41 @@ bool FileController::findExecutable(const QString &executableName, const QString
     return !QStandardPaths::findExecutable(executableName, paths).isEmpty();
 }
 
+bool FileController::canUseQuickSearch(const QString &localPath)
+{
+#ifdef DISABLE_QUICK_SEARCH
+    Q_UNUSED(localPath);
+    return false;
+#else // !DISABLE_QUICK_SEARCH
+    if (!QFileInfo::exists(localPath)) {
+        return false;
+    }
+
+    QPair<QString, QString> dev_and_mount_point{ DQuickSearch::getDevAndMountPoint(localPath) };
+    bool is_usb_dev{ DQuickSearch::isUsbDevice(dev_and_mount_point.first) };
+    bool whether_index_internal{ DFMApplication::instance()->genericAttribute(DFMApplication::GA_IndexInternal).toBool() };
+    bool whether_index_external{ DFMApplication::instance()->genericAttribute(DFMApplication::GA_IndexExternal).toBool() };
+
+#ifdef QT_DEBUG
+    qDebug() << localPath;
+#endif //QT_DEBUG
+
+    if ((whether_index_external && whether_index_internal)
+            || (!is_usb_dev && whether_index_internal)
+            || (is_usb_dev && whether_index_external)) {
+        bool whether_cached{ QuickSearchDaemonController::instance()->createCache() };
+
+#ifdef QT_DEBUG
+        qDebug() << whether_cached;
+#endif //QT_DEBUG
+
+        return whether_cached;
+    }
+
+    return false;
+#endif // DISABLE_QUICK_SEARCH
+}
+
 const DAbstractFileInfoPointer FileController::createFileInfo(const QSharedPointer<DFMCreateFileInfoEvnet> &event) const
 {
     if (event->url().toLocalFile().endsWith(QString(".") + DESKTOP_SURRIX)) {
@@ -1137,57 +1222,20 @@ bool FileDirIterator::enableIteratorByKeyword(const QString &keyword)
 #else // !DISABLE_QUICK_SEARCH
     const QString pathForSearching = iterator->url().toLocalFile();
 
-    if (QFileInfo::exists(pathForSearching)) {
-        QPair<QString, QString> dev_and_mount_point{ DQuickSearch::getDevAndMountPoint(pathForSearching) };
-        bool is_usb_dev{ DQuickSearch::isUsbDevice(dev_and_mount_point.first) };
-        bool whether_index_internal{ DFMApplication::instance()->genericAttribute(DFMApplication::GA_IndexInternal).toBool() };
-        bool whether_index_external{ DFMApplication::instance()->genericAttribute(DFMApplication::GA_IndexExternal).toBool() };
-
-#ifdef QT_DEBUG
-        qDebug() << pathForSearching;
-#endif //QT_DEBUG
-
-        std::function<bool()> invoke_quick_search{
-            [this, &keyword, &pathForSearching]()->bool
-            {
-                bool whether_cached{ QuickSearchDaemonController::instance()->createCache() };
-
-#ifdef QT_DEBUG
-                qDebug() << whether_cached;
-#endif //QT_DEBUG
+    if (!FileController::canUseQuickSearch(pathForSearching)) {
+        return false;
+    }
 
-                if (whether_cached)
-                {
-                    if (iterator) {
-                        delete iterator;
-                    }
+    if (iterator) {
+        delete iterator;
+    }
 
-                    iterator = new DFMQuickSearchDirIterator(pathForSearching, keyword);
+    iterator = new DFMQuickSearchDirIterator(pathForSearching, keyword);
 
 #ifdef QT_DEBUG
-                    qDebug() << pathForSearching;
+    qDebug() << pathForSearching;
 #endif //QT_DEBUG
-                    return true;
-                }
-
-                return false;
-            }
-        };
-
-        bool whether_use_quick_search{ false };
-        if (whether_index_external && whether_index_internal) {
-            whether_use_quick_search = invoke_quick_search();
 
-        } else if (!is_usb_dev && whether_index_internal) {
-            whether_use_quick_search = invoke_quick_search();
-
-        } else if (is_usb_dev && whether_index_external) {
-            whether_use_quick_search = invoke_quick_search();
-        }
-
-        return whether_use_quick_search;
-    }
-
-    return false;
+    return true;
 #endif // DISABLE_QUICK_SEARCH
 }
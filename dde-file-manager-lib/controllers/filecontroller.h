@@ -41,6 +41,8 @@ public:
     explicit FileController(QObject *parent = 0);
 
     static bool findExecutable(const QString & executableName, const QStringList & paths = QStringList());
+    // 本地路径是否可以使用 quick-search-daemon 搜索，可以时会让其开始建立缓存
+    static bool canUseQuickSearch(const QString &localPath);
 
     const DAbstractFileInfoPointer createFileInfo(const QSharedPointer<DFMCreateFileInfoEvnet> &event) const Q_DECL_OVERRIDE;
     const DDirIteratorPointer createDirIterator(const QSharedPointer<DFMCreateDiriterator> &event) const Q_DECL_OVERRIDE;
@@ -36,12 +36,33 @@ public:
     ~QuickSearchDaemonInterface();
 
 public Q_SLOTS: // METHODS
+    inline QDBusPendingReply<QDBusVariant> beginSearch(const QDBusVariant &current_dir, const QDBusVariant &key_words)
+    {
+        QList<QVariant> argumentList;
+        argumentList << QVariant::fromValue(current_dir) << QVariant::fromValue(key_words);
+        return asyncCallWithArgumentList(QStringLiteral("beginSearch"), argumentList);
+    }
+
+    inline QDBusPendingReply<> cancelSearch(const QDBusVariant &cursor)
+    {
+        QList<QVariant> argumentList;
+        argumentList << QVariant::fromValue(cursor);
+        return asyncCallWithArgumentList(QStringLiteral("cancelSearch"), argumentList);
+    }
+
     inline QDBusPendingReply<QDBusVariant> createCache()
     {
         QList<QVariant> argumentList;
         return asyncCallWithArgumentList(QStringLiteral("createCache"), argumentList);
     }
 
+    inline QDBusPendingReply<QDBusVariant> fetchSearchResult(const QDBusVariant &cursor, const QDBusVariant &max_count)
+    {
+        QList<QVariant> argumentList;
+        argumentList << QVariant::fromValue(cursor) << QVariant::fromValue(max_count);
+        return asyncCallWithArgumentList(QStringLiteral("fetchSearchResult"), argumentList);
+    }
+
     inline QDBusPendingReply<> fileWereCreated(const QDBusVariant &file_list)
     {
         QList<QVariant> argumentList;
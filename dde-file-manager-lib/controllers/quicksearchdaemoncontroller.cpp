@@ -76,6 +76,48 @@ QList<QString> QuickSearchDaemonController::search(const QString &path_for_searc
     return result_list;
 }
 
+quint64 QuickSearchDaemonController::beginSearch(const QString &path_for_searching, const QString &key)
+{
+    QFileInfo file_info{ path_for_searching };
+
+    if (QFileInfo::exists(path_for_searching) && file_info.isDir()) {
+        QDBusVariant var_local_file{ QVariant{path_for_searching} };
+        QDBusVariant var_key{QVariant{ key }};
+        QDBusVariant cursor{interface_ptr->beginSearch(var_local_file, var_key)};
+
+        return cursor.variant().toULongLong();
+    }
+
+    return 0;
+}
+
+QList<QString> QuickSearchDaemonController::fetchSearchResult(quint64 cursor, int max_count, bool *finished, bool *interrupted)
+{
+    QDBusVariant var_cursor{ QVariant{ cursor } };
+    QDBusVariant var_max_count{ QVariant{ max_count } };
+    QDBusPendingReply<QDBusVariant> reply{ interface_ptr->fetchSearchResult(var_cursor, var_max_count) };
+    reply.waitForFinished();
+
+    if (reply.isError()) {
+        *finished = true;
+        return QList<QString>{};
+    }
+
+    QVariantMap result_map{ qdbus_cast<QVariantMap>(reply.value().variant()) };
+    *finished = result_map.value("finished", true).toBool();
+
+    if (interrupted) {
+        *interrupted = result_map.value("interrupted", false).toBool();
+    }
+
+    return qdbus_cast<QStringList>(result_map.value("files"));
+}
+
+void QuickSearchDaemonController::cancelSearch(quint64 cursor)
+{
+    interface_ptr->cancelSearch(QDBusVariant{ QVariant{ cursor } });
+}
+
 void QuickSearchDaemonController::fileWereDeleted(const QList<QByteArray> &file_list)
 {
     if (!file_list.isEmpty()) {
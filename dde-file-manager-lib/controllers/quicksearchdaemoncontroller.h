@@ -50,6 +50,11 @@ public:
     bool whetherCacheCompletely()const noexcept;
     QList<QString> search(const QString &path_for_searching, const QString &key);
 
+    ///###: return 0 if the daemon can not search in path_for_searching.
+    quint64 beginSearch(const QString &path_for_searching, const QString &key);
+    QList<QString> fetchSearchResult(quint64 cursor, int max_count, bool *finished, bool *interrupted = nullptr);
+    void cancelSearch(quint64 cursor);
+
     void fileWereRenamed(const QList<QPair<QByteArray, QByteArray> > &file_list);
     void fileWereCreated(const QList<QByteArray> &file_list);
     void fileWereDeleted(const QList<QByteArray> &file_list);
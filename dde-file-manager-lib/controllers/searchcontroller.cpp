@@ -23,6 +23,7 @@
  */
 
 #include "searchcontroller.h"
+#include "filecontroller.h"
 #include "dfileservices.h"
 #include "dfmevent.h"
 #include "dfileproxywatcher.h"
@@ -33,6 +34,8 @@
 
 #include "app/define.h"
 #include "app/filesignalmanager.h"
+#include "controllers/pathmanager.h"
+#include "singleton.h"
 
 #include <DDesktopServices>
 
@@ -40,6 +43,17 @@
 #include <QRegularExpression>
 #include <QQueue>
 #include <QRegExp>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 QString searchKeywordPattern(const QString &keyword)
 {
@@ -235,6 +249,243 @@ bool SearchFileWatcherPrivate::stop()
     return ok;
 }
 
+// 在本地目录中并行搜索，直接用目录项中的文件名匹配关键字，只为匹配的文件创建文件信息
+class LocalFileSearcher
+{
+public:
+    struct Result {
+        QByteArray path;
+        // desktop 文件和系统目录的显示名称与文件名不同，需要创建文件信息后再匹配
+        bool checkDisplayName;
+    };
+
+    LocalFileSearcher(const QByteArray &path, const QByteArray &pattern, QDir::Filters filters)
+        : m_pattern(pattern)
+        , m_filters(filters)
+    {
+        for (const QString &systemPath : systemPathManager->systemPathsMap()) {
+            m_systemPaths << systemPath.toLocal8Bit();
+        }
+
+        m_directoryQueue << path;
+        m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+        m_workerCount = m_pool.maxThreadCount();
+
+        for (int i = 0; i < m_workerCount; ++i) {
+            m_workers << QtConcurrent::run(&m_pool, [this] {
+                worker();
+            });
+        }
+    }
+
+    ~LocalFileSearcher()
+    {
+        m_stopped.store(1);
+
+        for (QFuture<void> &worker : m_workers) {
+            worker.waitForFinished();
+        }
+    }
+
+    // 等待新的结果，超时或搜索结束时返回空列表
+    QList<Result> takeResults(int timeout, bool *finished)
+    {
+        QMutexLocker locker(&m_resultMutex);
+
+        if (m_results.isEmpty() && !m_finished) {
+            m_resultCondition.wait(&m_resultMutex, timeout);
+        }
+
+        QList<Result> results;
+
+        results.swap(m_results);
+        *finished = m_finished && results.isEmpty();
+
+        return results;
+    }
+
+private:
+    void worker()
+    {
+        QQueue<QByteArray> directory_queue;
+
+        Q_FOREVER {
+            if (directory_queue.isEmpty()) {
+                QMutexLocker locker(&m_mutex);
+
+                m_idleCount.ref();
+
+                // 所有线程都空闲且没有待搜索的目录时搜索结束
+                while (m_directoryQueue.isEmpty() && m_idleCount.load() < m_workerCount && !m_stopped.load()) {
+                    m_queueCondition.wait(&m_mutex, 100);
+                }
+
+                if (m_directoryQueue.isEmpty() || m_stopped.load()) {
+                    m_queueCondition.wakeAll();
+                    break;
+                }
+
+                m_idleCount.deref();
+                directory_queue << m_directoryQueue.dequeue();
+            }
+
+            if (m_stopped.load()) {
+                break;
+            }
+
+            searchDirectory(directory_queue.dequeue(), directory_queue);
+
+            // 有空闲的线程时分出一半目录给它们
+            if (directory_queue.size() > 1 && m_idleCount.load() > 0) {
+                QMutexLocker locker(&m_mutex);
+
+                while (directory_queue.size() > m_directoryQueue.size() + 1) {
+                    m_directoryQueue << directory_queue.takeLast();
+                }
+
+                m_queueCondition.wakeAll();
+            }
+        }
+
+        QMutexLocker locker(&m_resultMutex);
+
+        if (++m_finishedWorkerCount == m_workerCount) {
+            m_finished = true;
+            m_resultCondition.wakeAll();
+        }
+    }
+
+    void searchDirectory(const QByteArray &path, QQueue<QByteArray> &directoryQueue)
+    {
+        int dir_fd = open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (dir_fd < 0) {
+            return;
+        }
+
+        struct stat dir_stat;
+
+        // 挂载点和绑定挂载可能使同一个目录出现多次
+        if (fstat(dir_fd, &dir_stat) != 0 || !markVisited(dir_stat)) {
+            ::close(dir_fd);
+            return;
+        }
+
+        DIR *dir = fdopendir(dir_fd);
+
+        if (!dir) {
+            ::close(dir_fd);
+            return;
+        }
+
+        const QByteArray prefix = path.endsWith('/') ? path : path + '/';
+        const bool list_dirs = m_filters & (QDir::Dirs | QDir::AllDirs);
+        QList<Result> results;
+
+        while (const struct dirent *entry = readdir(dir)) {
+            const char *name = entry->d_name;
+
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            if (name[0] == '.' && !m_filters.testFlag(QDir::Hidden)) {
+                continue;
+            }
+
+            if (m_stopped.load()) {
+                break;
+            }
+
+            unsigned char type = entry->d_type;
+            struct stat st;
+
+            if (type == DT_UNKNOWN) {
+                type = fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 ? IFTODT(st.st_mode) : DT_REG;
+            }
+
+            if (type == DT_LNK && m_filters.testFlag(QDir::NoSymLinks)) {
+                continue;
+            }
+
+            if ((type == DT_CHR || type == DT_BLK || type == DT_FIFO || type == DT_SOCK) && !m_filters.testFlag(QDir::System)) {
+                continue;
+            }
+
+            // 不进入链接指向的目录
+            if (type == DT_DIR && list_dirs) {
+                directoryQueue << prefix + name;
+            }
+
+            const int name_length = int(strlen(name));
+            const bool is_desktop_file = name_length > 8 && strcmp(name + name_length - 8, ".desktop") == 0;
+            const bool check_display_name = is_desktop_file || (type == DT_DIR && m_systemPaths.contains(prefix + name));
+
+            if (!check_display_name && fnmatch(m_pattern.constData(), name, FNM_CASEFOLD | FNM_NOESCAPE) != 0) {
+                continue;
+            }
+
+            bool is_dir = type == DT_DIR;
+
+            if (type == DT_LNK) {
+                is_dir = fstatat(dir_fd, name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+            }
+
+            if (is_dir ? !list_dirs : !m_filters.testFlag(QDir::Files)) {
+                continue;
+            }
+
+            results << Result {prefix + name, check_display_name};
+        }
+
+        closedir(dir);
+
+        if (!results.isEmpty()) {
+            QMutexLocker locker(&m_resultMutex);
+
+            m_results << results;
+            m_resultCondition.wakeAll();
+        }
+    }
+
+    bool markVisited(const struct stat &st)
+    {
+        QMutexLocker locker(&m_visitedMutex);
+        const QPair<quint64, quint64> inode(st.st_dev, st.st_ino);
+
+        if (m_visitedDirectories.contains(inode)) {
+            return false;
+        }
+
+        m_visitedDirectories.insert(inode);
+
+        return true;
+    }
+
+    QByteArray m_pattern;
+    QDir::Filters m_filters;
+    QSet<QByteArray> m_systemPaths;
+    QThreadPool m_pool;
+    QList<QFuture<void>> m_workers;
+    QAtomicInt m_stopped;
+
+    // 各线程共享的待搜索目录，线程自己的队列不为空时不会访问它
+    QMutex m_mutex;
+    QWaitCondition m_queueCondition;
+    QQueue<QByteArray> m_directoryQueue;
+    int m_workerCount = 0;
+    QAtomicInt m_idleCount;
+
+    QMutex m_visitedMutex;
+    QSet<QPair<quint64, quint64>> m_visitedDirectories;
+
+    QMutex m_resultMutex;
+    QWaitCondition m_resultCondition;
+    QList<Result> m_results;
+    int m_finishedWorkerCount = 0;
+    bool m_finished = false;
+};
+
 class SearchDiriterator : public DDirIterator
 {
 public:
@@ -262,9 +513,11 @@ public:
     QStringList m_nameFilters;
     QDir::Filters m_filter;
     QDirIterator::IteratorFlags m_flags;
-    mutable QList<DUrl> searchPathList;
+    mutable QQueue<DUrl> searchPathList;
+    mutable QSet<DUrl> searchedPathSet;
     mutable DDirIteratorPointer it;
     mutable bool m_hasIteratorByKeywordOfCurrentIt;
+    mutable QScopedPointer<LocalFileSearcher> localSearcher;
 
     bool closed = false;
 };
@@ -284,6 +537,7 @@ SearchDiriterator::SearchDiriterator(const DUrl &url, const QStringList &nameFil
 
     regular = QRegExp(keyword, Qt::CaseInsensitive, QRegExp::Wildcard);
     searchPathList << targetUrl;
+    searchedPathSet << targetUrl;
 }
 
 SearchDiriterator::~SearchDiriterator()
@@ -312,15 +566,57 @@ bool SearchDiriterator::hasNext() const
 
     forever {
         if (closed) {
+            localSearcher.reset();
+
             return false;
         }
 
+        if (localSearcher) {
+            bool finished = false;
+            const QList<LocalFileSearcher::Result> &results = localSearcher->takeResults(100, &finished);
+
+            if (finished) {
+                localSearcher.reset();
+                continue;
+            }
+
+            // 一次取出所有已找到的文件，使其能成批地加入到模型中
+            for (const LocalFileSearcher::Result &result : results) {
+                const DUrl &realUrl = DUrl::fromLocalFile(QString::fromLocal8Bit(result.path));
+
+                if (result.checkDisplayName) {
+                    const DAbstractFileInfoPointer &fileInfo = DFileService::instance()->createFileInfo(parent, realUrl);
+
+                    if (!fileInfo || !regular.exactMatch(fileInfo->fileDisplayName())) {
+                        continue;
+                    }
+                }
+
+                DUrl url = m_fileUrl;
+
+                url.setSearchedFileUrl(realUrl);
+                childrens << url;
+            }
+
+            if (!childrens.isEmpty()) {
+                return true;
+            }
+
+            continue;
+        }
+
         if (!it) {
             if (searchPathList.isEmpty()) {
                 break;
             }
 
-            const DUrl &url = searchPathList.takeAt(0);
+            const DUrl url = searchPathList.dequeue();
+
+            // 不能使用快速搜索的本地目录在后台多个线程中搜索
+            if (url.isLocalFile() && m_nameFilters.isEmpty() && !FileController::canUseQuickSearch(url.toLocalFile())) {
+                localSearcher.reset(new LocalFileSearcher(url.toLocalFile().toLocal8Bit(), keyword.toLocal8Bit(), m_filter));
+                continue;
+            }
 
             it = DFileService::instance()->createDirIterator(parent, url, m_nameFilters, QDir::NoDotAndDotDot | m_filter, m_flags);
 
@@ -355,8 +651,9 @@ bool SearchDiriterator::hasNext() const
             if (fileInfo->isDir() && !fileInfo->isSymLink()) {
                 const DUrl &url = fileInfo->fileUrl();
 
-                if (!searchPathList.contains(url)) {
+                if (!searchedPathSet.contains(url)) {
                     searchPathList << url;
+                    searchedPathSet << url;
                 }
             }
 
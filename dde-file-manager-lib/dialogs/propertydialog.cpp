@@ -598,8 +598,10 @@ void PropertyDialog::startComputerFolderSize(const DUrl &url)
     DUrlList urls;
     urls << validUrl;
 
-    if (!m_sizeWorker)
+    if (!m_sizeWorker) {
         m_sizeWorker = new DFileStatisticsJob(this);
+        m_sizeWorker->setFileHints(DFileStatisticsJob::SkipDuplicateHardLinks);
+    }
 
     connect(m_sizeWorker, &DFileStatisticsJob::dataNotify, this, &PropertyDialog::updateFolderSize);
 
@@ -52,7 +52,10 @@
 #include <QDebug>
 #include <QApplication>
 #include <QCollator>
+#include <QThreadStorage>
 #include <QWriteLocker>
+#include <QReadWriteLock>
+#include <QHash>
 #include <QJsonParseError>
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -71,7 +74,21 @@
 
 namespace FileSortFunction
 {
-QCollator sortCollator;
+// QCollator 不是线程安全的，并行排序时每个线程使用自己的 collator，且只在创建时设置一次
+QThreadStorage<QCollator> sortCollators;
+
+QCollator &sortCollator()
+{
+    if (!sortCollators.hasLocalData()) {
+        QCollator collator;
+
+        collator.setNumericMode(true);
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+        sortCollators.setLocalData(collator);
+    }
+
+    return sortCollators.localData();
+}
 
 bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder order)
 {
@@ -83,10 +100,48 @@ bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder ord
         return order != Qt::DescendingOrder;
     }
 
-    return ((order == Qt::DescendingOrder) ^ (sortCollator.compare(str1, str2) < 0)) == 0x01;
+    return ((order == Qt::DescendingOrder) ^ (sortCollator().compare(str1, str2) < 0)) == 0x01;
+}
+
+bool compareByDisplayNameSortKey(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order)
+{
+    bool startWithHanzi1 = false;
+    bool startWithHanzi2 = false;
+    const QCollatorSortKey key1 = info1->fileDisplayNameSortKey(&startWithHanzi1);
+    const QCollatorSortKey key2 = info2->fileDisplayNameSortKey(&startWithHanzi2);
+
+    if (startWithHanzi1) {
+        if (!startWithHanzi2) {
+            return order == Qt::DescendingOrder;
+        }
+    } else if (startWithHanzi2) {
+        return order != Qt::DescendingOrder;
+    }
+
+    int result = key1.compare(key2);
+
+    // 相等时不论升序还是降序都必须返回 false，否则排序时的比较规则不成立
+    if (result == 0) {
+        return false;
+    }
+
+    return order == Qt::DescendingOrder ? result > 0 : result < 0;
+}
+
+bool compareFileListByDisplayName(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order)
+{
+    bool isDir1 = info1->isDir();
+    bool isDir2 = info2->isDir();
+
+    if (isDir1) {
+        if (!isDir2) return true;
+    } else {
+        if (isDir2) return false;
+    }
+
+    return compareByDisplayNameSortKey(info1, info2, order);
 }
 
-COMPARE_FUN_DEFINE(fileDisplayName, DisplayName, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(fileSize, Size, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(lastModified, Modified, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(fileTypeDisplayName, Mime, DAbstractFileInfo)
@@ -98,8 +153,85 @@ COMPARE_FUN_DEFINE(lastRead, LastRead, DAbstractFileInfo)
     Q_D(const DAbstractFileInfo);\
     if (d->proxy) return d->proxy->Fun;
 
-QMap<DUrl, DAbstractFileInfo *> DAbstractFileInfoPrivate::urlToFileInfoMap;
-QReadWriteLock *DAbstractFileInfoPrivate::urlToFileInfoMapLock = new QReadWriteLock();
+namespace {
+// 缓存中只保存文件信息对象的指针，不持有引用，对象析构时将自己移除
+// 按url的哈希值分片，不同线程创建和析构对象时不会竞争同一个锁
+class FileInfoCache
+{
+public:
+    void insert(const DUrl &url, DAbstractFileInfo *info)
+    {
+        Shard &shard = this->shard(url);
+        QWriteLocker locker(&shard.lock);
+        Q_UNUSED(locker)
+
+        shard.infos[url] = info;
+    }
+
+    void remove(const DUrl &url, DAbstractFileInfo *info)
+    {
+        Shard &shard = this->shard(url);
+        QWriteLocker locker(&shard.lock);
+        Q_UNUSED(locker)
+
+        auto it = shard.infos.find(url);
+
+        if (it != shard.infos.end() && it.value() == info)
+            shard.infos.erase(it);
+    }
+
+    DAbstractFileInfoPointer value(const DUrl &url)
+    {
+        Shard &shard = this->shard(url);
+        QReadLocker locker(&shard.lock);
+        Q_UNUSED(locker)
+
+        DAbstractFileInfo *info = shard.infos.value(url);
+
+        if (!info)
+            return DAbstractFileInfoPointer();
+
+        // 引用计数为0时对象正在析构，不能再被引用
+        for (int count = info->ref.load(); count > 0; count = info->ref.load()) {
+            if (info->ref.testAndSetOrdered(count, count + 1)) {
+                DAbstractFileInfoPointer pointer(info);
+
+                info->ref.deref();
+
+                return pointer;
+            }
+        }
+
+        return DAbstractFileInfoPointer();
+    }
+
+private:
+    enum {
+        ShardCount = 16
+    };
+
+    struct Shard {
+        QReadWriteLock lock;
+        QHash<DUrl, DAbstractFileInfo*> infos;
+    };
+
+    Shard &shard(const DUrl &url)
+    {
+        return shards[qHash(url) % ShardCount];
+    }
+
+    Shard shards[ShardCount];
+};
+}
+
+// 不释放，保证在静态对象析构时依然可用
+static FileInfoCache *fileInfoCache()
+{
+    static FileInfoCache *cache = new FileInfoCache();
+
+    return cache;
+}
+
 DMimeDatabase DAbstractFileInfoPrivate::mimeDatabase;
 
 DAbstractFileInfoPrivate::DAbstractFileInfoPrivate(const DUrl &url, DAbstractFileInfo *qq, bool hasCache)
@@ -108,27 +240,22 @@ DAbstractFileInfoPrivate::DAbstractFileInfoPrivate(const DUrl &url, DAbstractFil
 {
     //###(zccrs): 只在主线程中开启缓存，防止不同线程中持有同一对象时的竞争问题
     if (hasCache && url.isValid() && QThread::currentThread() == qApp->thread()) {
-        QWriteLocker locker(urlToFileInfoMapLock);
-        Q_UNUSED(locker)
-
-        urlToFileInfoMap[url] = qq;
+        fileInfoCache()->insert(url, qq);
+        cached = true;
     }
-
-    FileSortFunction::sortCollator.setNumericMode(true);
-    FileSortFunction::sortCollator.setCaseSensitivity(Qt::CaseInsensitive);
 }
 
 DAbstractFileInfoPrivate::~DAbstractFileInfoPrivate()
 {
-    QReadLocker locker(urlToFileInfoMapLock);
-    if (urlToFileInfoMap.value(fileUrl) == q_ptr) {
-        locker.unlock();
-        QWriteLocker locker(urlToFileInfoMapLock);
-        Q_UNUSED(locker)
-        urlToFileInfoMap.remove(fileUrl);
-    } else {
-        locker.unlock();
-    }
+    if (cached)
+        fileInfoCache()->remove(fileUrl, q_ptr);
+}
+
+void DAbstractFileInfoPrivate::clearSortKey() const
+{
+    QMutexLocker locker(&sortKeyMutex);
+
+    sortKey.reset();
 }
 
 void DAbstractFileInfoPrivate::setUrl(const DUrl &url, bool hasCache)
@@ -137,33 +264,32 @@ void DAbstractFileInfoPrivate::setUrl(const DUrl &url, bool hasCache)
         return;
     }
 
-    if (urlToFileInfoMap.value(fileUrl) == q_ptr) {
-        QWriteLocker locker(urlToFileInfoMapLock);
-        Q_UNUSED(locker)
-        urlToFileInfoMap.remove(fileUrl);
+    if (cached) {
+        fileInfoCache()->remove(fileUrl, q_ptr);
+        cached = false;
     }
 
     if (hasCache) {
-        QWriteLocker locker(urlToFileInfoMapLock);
-        Q_UNUSED(locker)
-        urlToFileInfoMap[url] = q_ptr;
+        fileInfoCache()->insert(url, q_ptr);
+        cached = true;
     }
 
     fileUrl = url;
+    clearSortKey();
 }
 
-DAbstractFileInfo *DAbstractFileInfoPrivate::getFileInfo(const DUrl &fileUrl)
+DAbstractFileInfoPointer DAbstractFileInfoPrivate::getFileInfo(const DUrl &fileUrl)
 {
     //###(zccrs): 只在主线程中开启缓存，防止不同线程中持有同一对象时的竞争问题
     if (QThread::currentThread() != qApp->thread()) {
-        return 0;
+        return DAbstractFileInfoPointer();
     }
 
     if (!fileUrl.isValid()) {
-        return nullptr;
+        return DAbstractFileInfoPointer();
     }
 
-    return urlToFileInfoMap.value(fileUrl);
+    return fileInfoCache()->value(fileUrl);
 }
 
 DAbstractFileInfo::DAbstractFileInfo(const DUrl &url, bool hasCache)
@@ -179,7 +305,7 @@ DAbstractFileInfo::~DAbstractFileInfo()
 
 const DAbstractFileInfoPointer DAbstractFileInfo::getFileInfo(const DUrl &fileUrl)
 {
-    return DAbstractFileInfoPointer(DAbstractFileInfoPrivate::getFileInfo(fileUrl));
+    return DAbstractFileInfoPrivate::getFileInfo(fileUrl);
 }
 
 bool DAbstractFileInfo::exists() const
@@ -312,6 +438,34 @@ QString DAbstractFileInfo::fileDisplayPinyinName() const
     return d->pinyinName;
 }
 
+QCollatorSortKey DAbstractFileInfo::fileDisplayNameSortKey(bool *startWithHanzi) const
+{
+    Q_D(const DAbstractFileInfo);
+
+    QMutexLocker locker(&d->sortKeyMutex);
+
+    if (!d->sortKey) {
+        // 生成排序键时不持有锁，其它线程同时生成时使用先生成的
+        locker.unlock();
+
+        const QString &displayName = fileDisplayName();
+        QScopedPointer<FileDisplayNameSortKey> sortKey(new FileDisplayNameSortKey {FileSortFunction::sortCollator().sortKey(displayName),
+                                                                                   DFMGlobal::startWithHanzi(displayName)});
+
+        locker.relock();
+
+        if (!d->sortKey) {
+            d->sortKey.swap(sortKey);
+        }
+    }
+
+    if (startWithHanzi) {
+        *startWithHanzi = d->sortKey->startWithHanzi;
+    }
+
+    return d->sortKey->key;
+}
+
 bool DAbstractFileInfo::canRename() const
 {
     CALL_PROXY(canRename());
@@ -1383,6 +1537,8 @@ bool DAbstractFileInfo::isActive() const
 
 void DAbstractFileInfo::refresh()
 {
+    d_func()->clearSortKey();
+
     CALL_PROXY(refresh());
 #ifdef SW_LABEL
     updateLabelMenuItems();
@@ -57,7 +57,7 @@ bool compareFileListBy##Name(const DAbstractFileInfoPointer &info1, const DAbstr
     }\
     \
     if ((isDir1 && isDir2 && (value1 == value2)) || (isFile1 && isFile2 && (value1 == value2))) {\
-        return compareByString(info1->fileDisplayName(), info2->fileDisplayName());\
+        return compareByDisplayNameSortKey(info1, info2, Qt::AscendingOrder);\
     }\
     \
     bool isStrType = typeid(value1) == typeid(QString);\
@@ -67,8 +67,20 @@ bool compareFileListBy##Name(const DAbstractFileInfoPointer &info1, const DAbstr
     return ((order == Qt::DescendingOrder) ^ (value1 < value2)) == 0x01;\
 }
 
+QT_BEGIN_NAMESPACE
+class QCollatorSortKey;
+QT_END_NAMESPACE
+
+class DAbstractFileInfo;
+class DAbstractFileWatcher;
+typedef QExplicitlySharedDataPointer<DAbstractFileInfo> DAbstractFileInfoPointer;
+typedef std::function<const DAbstractFileInfoPointer(int)> getFileInfoFun;
+typedef DFMGlobal::MenuAction MenuAction;
+class DAbstractFileInfoPrivate;
+
 namespace FileSortFunction {
 bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder order = Qt::AscendingOrder);
+bool compareByDisplayNameSortKey(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order);
 template<typename T>
 bool compareByString(T, T, Qt::SortOrder order = Qt::AscendingOrder)
 {
@@ -78,13 +90,6 @@ bool compareByString(T, T, Qt::SortOrder order = Qt::AscendingOrder)
 }
 }
 
-class DAbstractFileInfo;
-class DAbstractFileWatcher;
-typedef QExplicitlySharedDataPointer<DAbstractFileInfo> DAbstractFileInfoPointer;
-typedef std::function<const DAbstractFileInfoPointer(int)> getFileInfoFun;
-typedef DFMGlobal::MenuAction MenuAction;
-class DAbstractFileInfoPrivate;
-
 
 #ifdef SW_LABEL
 
@@ -159,6 +164,8 @@ public:
     virtual QString fileDisplayName() const;
     virtual QString fileSharedName() const;
     QString fileDisplayPinyinName() const;
+    /// collation key of fileDisplayName(), built once and cleared by refresh() and url changes
+    QCollatorSortKey fileDisplayNameSortKey(bool *startWithHanzi = nullptr) const;
 
     virtual bool canRename() const;
     virtual bool canShare() const;
@@ -36,6 +36,7 @@
 #include "usershare/usersharemanager.h"
 #include "deviceinfo/udisklistener.h"
 #include "tag/tagmanager.h"
+#include "tag/tagutil.h"
 
 #include "dfileservices.h"
 #include "dthumbnailprovider.h"
@@ -45,6 +46,7 @@
 #include "dstorageinfo.h"
 
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QDir>
 #include <QPainter>
 #include <QApplication>
@@ -68,13 +70,14 @@ public:
     ~RequestEP();
 
     // Request get the file extension propertys
-    QQueue<QPair<DUrl, DFileInfoPrivate*>> requestEPFiles;
-    QReadWriteLock requestEPFilesLock;
+    QHash<DFileInfoPrivate*, DUrl> requestEPFiles;
+    QMutex requestEPFilesMutex;
     QSet<DFileInfoPrivate*> dirtyFileInfos;
 
     void run() override;
     void requestEP(const DUrl &url, DFileInfoPrivate *info);
     void cancelRequestEP(DFileInfoPrivate *info);
+    void clearTagCache(const QList<QString> &files = QList<QString>());
 
 Q_SIGNALS:
     void requestEPFinished(const DUrl &url, const QVariantHash &ep);
@@ -84,8 +87,24 @@ Q_SIGNALS:
 
 private:
     explicit RequestEP(QObject *parent = 0);
+
+    // 按目录缓存文件的标记，标记变化时清除。守护进程删除或重命名文件时客户端收不到所有的变化，
+    // 因此每个目录的缓存只在一段时间内有效
+    struct DirTagCache
+    {
+        QHash<DUrl, QStringList> fileTags;
+        QElapsedTimer age;
+    };
+
+    QHash<DUrl, DirTagCache> dirTagCache;
+    QHash<QString, QColor> tagColorCache;
+    QMutex tagCacheMutex;
+    quint64 tagCacheGeneration = 0;
 };
 
+#define TAG_CACHE_MAX_DIR_COUNT 64
+#define TAG_CACHE_MAX_AGE 10000 // 毫秒
+
 RequestEP::RequestEP(QObject *parent)
     : QThread(parent)
 {
@@ -95,6 +114,23 @@ RequestEP::RequestEP(QObject *parent)
     connect(this, &RequestEP::finished, this, [this] {
         dirtyFileInfos.clear();
     });
+
+    // 缓存可能在任意线程中使用，直接在信号发出的线程中清除
+    connect(TagManager::instance(), &TagManager::filesWereTagged, this, [this] (const QMap<QString, QList<QString>> &files) {
+        clearTagCache(files.keys());
+    }, Qt::DirectConnection);
+    connect(TagManager::instance(), &TagManager::untagFiles, this, [this] (const QMap<QString, QList<QString>> &files) {
+        clearTagCache(files.keys());
+    }, Qt::DirectConnection);
+    connect(TagManager::instance(), &TagManager::changeTagName, this, [this] {
+        clearTagCache();
+    }, Qt::DirectConnection);
+    connect(TagManager::instance(), &TagManager::changeTagColor, this, [this] {
+        clearTagCache();
+    }, Qt::DirectConnection);
+    connect(TagManager::instance(), &TagManager::deleteTag, this, [this] {
+        clearTagCache();
+    }, Qt::DirectConnection);
 }
 
 RequestEP *RequestEP::instance()
@@ -110,9 +146,9 @@ RequestEP *RequestEP::instance()
 
 RequestEP::~RequestEP()
 {
-    requestEPFilesLock.lockForWrite();
+    requestEPFilesMutex.lock();
     requestEPFiles.clear();
-    requestEPFilesLock.unlock();
+    requestEPFilesMutex.unlock();
 
     if (!wait(1000)) {
         terminate();
@@ -122,57 +158,141 @@ RequestEP::~RequestEP()
 void RequestEP::run()
 {
     forever {
-        requestEPFilesLock.lockForRead();
-        if (requestEPFiles.isEmpty()) {
-            requestEPFilesLock.unlock();
+        QHash<DFileInfoPrivate*, DUrl> file_infos;
+
+        requestEPFilesMutex.lock();
+        file_infos.swap(requestEPFiles);
+        requestEPFilesMutex.unlock();
+
+        if (file_infos.isEmpty()) {
             return;
         }
-        requestEPFilesLock.unlock();
-        requestEPFilesLock.lockForWrite();
-        auto file_info = requestEPFiles.dequeue();
-        requestEPFilesLock.unlock();
 
-        const DUrl &url = file_info.first;
-        const QStringList &tag_list = DFileService::instance()->getTagsThroughFiles(nullptr, {url});
+        // 一次取出所有等待中的文件，缓存中没有的文件通过一次调用获取标记
+        QHash<DUrl, QStringList> file_tags;
+        QList<DUrl> uncached_files;
+        QSet<QString> uncached_tags;
+
+        tagCacheMutex.lock();
+
+        const quint64 generation = tagCacheGeneration;
+
+        for (const DUrl &url : file_infos) {
+            auto dir_cache = dirTagCache.find(url.parentUrl());
 
-        QVariantHash ep;
+            if (dir_cache != dirTagCache.end() && dir_cache->age.hasExpired(TAG_CACHE_MAX_AGE)) {
+                dirTagCache.erase(dir_cache);
+                dir_cache = dirTagCache.end();
+            }
 
-        if (!tag_list.isEmpty()) {
-            ep["tag_name_list"] = tag_list;
+            if (dir_cache != dirTagCache.end() && dir_cache->fileTags.contains(url)) {
+                file_tags[url] = dir_cache->fileTags.value(url);
+            } else if (!file_tags.contains(url)) {
+                file_tags[url] = QStringList();
+                uncached_files << url;
+            }
         }
 
-        QList<QColor> colors;
+        tagCacheMutex.unlock();
+
+        if (!uncached_files.isEmpty()) {
+            const QHash<DUrl, QList<QString>> &tags_of_files = TagManager::instance()->getTagsOfFiles(uncached_files);
+
+            QMutexLocker locker(&tagCacheMutex);
+
+            if (dirTagCache.size() > TAG_CACHE_MAX_DIR_COUNT) {
+                dirTagCache.clear();
+            }
+
+            for (const DUrl &url : uncached_files) {
+                const QStringList &tag_list = tags_of_files.value(url);
+
+                file_tags[url] = tag_list;
 
-        for (const QColor &color : TagManager::instance()->getTagColor(tag_list)) {
-            colors << color;
+                // 查询期间标记发生了变化时不能缓存结果
+                if (generation == tagCacheGeneration) {
+                    DirTagCache &dir_cache = dirTagCache[url.parentUrl()];
+
+                    if (!dir_cache.age.isValid()) {
+                        dir_cache.age.start();
+                    }
+
+                    dir_cache.fileTags[url] = tag_list;
+                }
+            }
         }
 
-        if (!colors.isEmpty()) {
-            ep["colored"] = QVariant::fromValue(colors);
+        tagCacheMutex.lock();
+
+        for (const QStringList &tag_list : file_tags) {
+            for (const QString &tag : tag_list) {
+                if (!tagColorCache.contains(tag)) {
+                    uncached_tags << tag;
+                }
+            }
         }
 
-        QMetaObject::invokeMethod(this, "processEPChanged", Qt::QueuedConnection,
-                                  Q_ARG(DUrl, url), Q_ARG(DFileInfoPrivate*, file_info.second), Q_ARG(QVariantHash, ep));
+        QHash<QString, QColor> tag_colors = tagColorCache;
+
+        tagCacheMutex.unlock();
+
+        if (!uncached_tags.isEmpty()) {
+            const QMap<QString, QColor> &colors = TagManager::instance()->getTagColor(uncached_tags.toList());
+
+            QMutexLocker locker(&tagCacheMutex);
+
+            for (auto i = colors.constBegin(); i != colors.constEnd(); ++i) {
+                tag_colors[i.key()] = i.value();
+
+                if (generation == tagCacheGeneration) {
+                    tagColorCache[i.key()] = i.value();
+                }
+            }
+        }
+
+        for (auto file_info = file_infos.constBegin(); file_info != file_infos.constEnd(); ++file_info) {
+            const DUrl &url = file_info.value();
+            const QStringList &tag_list = file_tags.value(url);
+
+            QVariantHash ep;
+
+            if (!tag_list.isEmpty()) {
+                ep["tag_name_list"] = tag_list;
+            }
+
+            QList<QColor> colors;
+            QStringList sorted_tag_list = tag_list;
+
+            // 与标记名称的顺序一致
+            std::sort(sorted_tag_list.begin(), sorted_tag_list.end());
+
+            for (const QString &tag : sorted_tag_list) {
+                if (tag_colors.contains(tag)) {
+                    colors << tag_colors.value(tag);
+                }
+            }
+
+            if (!colors.isEmpty()) {
+                ep["colored"] = QVariant::fromValue(colors);
+            }
+
+            QMetaObject::invokeMethod(this, "processEPChanged", Qt::QueuedConnection,
+                                      Q_ARG(DUrl, url), Q_ARG(DFileInfoPrivate*, file_info.key()), Q_ARG(QVariantHash, ep));
+        }
     }
 }
 
 void RequestEP::requestEP(const DUrl &url, DFileInfoPrivate *info)
 {
-    requestEPFilesLock.lockForRead();
+    requestEPFilesMutex.lock();
 
-    for (int i = 0; i < requestEPFiles.count(); ++i) {
-        auto file_info = requestEPFiles.at(i);
-
-        if (file_info.second == info) {
-            requestEPFilesLock.unlock();
-            return;
-        }
+    if (requestEPFiles.contains(info)) {
+        requestEPFilesMutex.unlock();
+        return;
     }
 
-    requestEPFilesLock.unlock();
-    requestEPFilesLock.lockForWrite();
-    requestEPFiles << qMakePair(url, info);
-    requestEPFilesLock.unlock();
+    requestEPFiles[info] = url;
+    requestEPFilesMutex.unlock();
 
     if (!isRunning()) {
         start();
@@ -182,23 +302,39 @@ void RequestEP::requestEP(const DUrl &url, DFileInfoPrivate *info)
 void RequestEP::cancelRequestEP(DFileInfoPrivate *info)
 {
     dirtyFileInfos << info;
-    requestEPFilesLock.lockForRead();
-
-    for (int i = 0; i < requestEPFiles.count(); ++i) {
-        auto file_info = requestEPFiles.at(i);
-
-        if (file_info.second == info) {
-            requestEPFilesLock.unlock();
-            requestEPFilesLock.lockForWrite();
-            requestEPFiles.removeAt(i);
-            requestEPFilesLock.unlock();
-            info->requestEP = nullptr;
-            dirtyFileInfos.remove(info);
+
+    QMutexLocker locker(&requestEPFilesMutex);
+
+    if (requestEPFiles.remove(info) > 0) {
+        info->requestEP = nullptr;
+        dirtyFileInfos.remove(info);
+    }
+}
+
+void RequestEP::clearTagCache(const QList<QString> &files)
+{
+    QMutexLocker locker(&tagCacheMutex);
+
+    ++tagCacheGeneration;
+
+    if (files.isEmpty()) {
+        dirTagCache.clear();
+        tagColorCache.clear();
+
+        return;
+    }
+
+    for (const QString &file : files) {
+        const QString &path = Tag::restore_escaped_en_skim(file);
+
+        if (!path.startsWith('/')) {
+            dirTagCache.clear();
+
             return;
         }
-    }
 
-    requestEPFilesLock.unlock();
+        dirTagCache.remove(DUrl::fromLocalFile(path).parentUrl());
+    }
 }
 
 void RequestEP::processEPChanged(const DUrl &url, DFileInfoPrivate *info, const QVariantHash &ep)
@@ -745,6 +881,7 @@ void DFileInfo::refresh()
     Q_D(DFileInfo);
 
     d->fileInfo.refresh();
+    d->clearSortKey();
     d->icon = QIcon();
     d->epInitialized = false;
     d->hasThumbnail = -1;
@@ -781,7 +918,7 @@ void DFileInfo::makeToInactive()
         d->getIconTimer->deleteLater();
     } else if (d->requestingThumbnail) {
         d->requestingThumbnail = false;
-        DThumbnailProvider::instance()->removeInProduceQueue(d->fileInfo, DThumbnailProvider::Large);
+        DThumbnailProvider::instance()->removeInProduceQueue(d->fileInfo, DThumbnailProvider::Large, d->thumbnailRequestId);
     }
 
     if (d->getEPTimer) {
@@ -840,8 +977,8 @@ QIcon DFileInfo::fileIcon() const
             timer->setInterval(REQUEST_THUMBNAIL_DEALY);
 
             QObject::connect(timer, &QTimer::timeout, timer, [fileUrl, timer, me] {
-                DThumbnailProvider::instance()->appendToProduceQueue(me->d_func()->fileInfo, DThumbnailProvider::Large,
-                                                                     [me] (const QString &path) {
+                me->d_func()->thumbnailRequestId = DThumbnailProvider::instance()->appendToProduceQueue(me->d_func()->fileInfo, DThumbnailProvider::Large,
+                                                                                                        [me] (const QString &path) {
                     if (path.isEmpty()) {
                         me->d_func()->iconFromTheme = true;
                     } else {
@@ -51,8 +51,13 @@
 #include <QAbstractItemView>
 #include <QtConcurrent/QtConcurrent>
 
+#include <algorithm>
+#include <functional>
+
 #define fileService DFileService::instance()
 #define DEFAULT_COLUMN_COUNT 0
+// 文件数量超过此值的倍数时才会分块并行排序
+#define PARALLEL_SORT_MIN_CHUNK_SIZE 5000
 
 class FileSystemNode : public QSharedData
 {
@@ -75,6 +80,7 @@ public:
     {
         children[url] = node;
         visibleChildren.insert(index, node.data());
+        node->rowHint.store(index);
     }
 
     void insertChildren(int index, const DUrl &url, const FileSystemNodePointer &node)
@@ -87,6 +93,7 @@ public:
     void noLockAppendChildren(const DUrl& url, const FileSystemNodePointer &node)
     {
         children[url] = node;
+        node->rowHint.store(visibleChildren.count());
         visibleChildren.append(node.data());
     }
 
@@ -138,7 +145,7 @@ public:
     int indexOfChild(FileSystemNode *node)
     {
         rwLock->lockForRead();
-        int index = visibleChildren.indexOf(node);
+        int index = noLockIndexOfChild(node);
         rwLock->unlock();
 
         return index;
@@ -148,12 +155,40 @@ public:
     {
         rwLock->lockForRead();
         const FileSystemNodePointer &node = children.value(url);
-        int index = visibleChildren.indexOf(node.data());
+        int index = node ? noLockIndexOfChild(node.data()) : -1;
         rwLock->unlock();
 
         return index;
     }
 
+    // 在已排序的列表中二分查找新文件应插入的位置（插入到所有“不大于”它的文件之后）
+    int sortedInsertRow(const DAbstractFileInfoPointer &info,
+                        const DAbstractFileInfo::CompareFunction &compareFun,
+                        Qt::SortOrder order)
+    {
+        QReadLocker rl(rwLock);
+
+        auto iter = std::upper_bound(visibleChildren.constBegin(), visibleChildren.constEnd(), info,
+                                     [&] (const DAbstractFileInfoPointer &value, const FileSystemNode *node) {
+            return compareFun(value, node->fileInfo, order);
+        });
+
+        return iter - visibleChildren.constBegin();
+    }
+
+    // 列表中文件夹总是排在文件之前，二分查找第一个文件的位置
+    int firstFileRow()
+    {
+        QReadLocker rl(rwLock);
+
+        auto iter = std::partition_point(visibleChildren.constBegin(), visibleChildren.constEnd(),
+                                         [] (const FileSystemNode *node) {
+            return !node->fileInfo->isFile();
+        });
+
+        return iter - visibleChildren.constBegin();
+    }
+
     int childrenCount()
     {
         QReadLocker rl(rwLock);
@@ -186,6 +221,10 @@ public:
     {
         rwLock->lockForWrite();
         visibleChildren = list;
+
+        for (int i = 0; i < visibleChildren.count(); ++i)
+            visibleChildren.at(i)->rowHint.store(i);
+
         rwLock->unlock();
     }
 
@@ -212,9 +251,43 @@ public:
     }
 
 private:
+    // 节点的行号只会因其前面的文件被插入或移除而发生少量偏移，
+    // 因此从上次记录的行号开始向两边查找，避免每次都从头遍历整个列表
+    int noLockIndexOfChild(FileSystemNode *node) const
+    {
+        const int count = visibleChildren.count();
+
+        if (count == 0)
+            return -1;
+
+        const int hint = qBound(0, node->rowHint.load(), count - 1);
+
+        for (int offset = 0; hint - offset >= 0 || hint + offset < count; ++offset) {
+            int row = hint + offset;
+
+            if (row < count && visibleChildren.at(row) == node) {
+                node->rowHint.store(row);
+
+                return row;
+            }
+
+            row = hint - offset;
+
+            if (offset > 0 && row >= 0 && visibleChildren.at(row) == node) {
+                node->rowHint.store(row);
+
+                return row;
+            }
+        }
+
+        return -1;
+    }
+
     QHash<DUrl, FileSystemNodePointer> children;
     QList<FileSystemNode*> visibleChildren;
     QReadWriteLock *rwLock = nullptr;
+    // 在父节点中最后一次被查找到的行号
+    QAtomicInt rowHint;
 };
 
 template<typename T>
@@ -418,33 +491,91 @@ public:
     }
 
 private:
+    // 一批增量更新中连续的一段行，插入时 nodes 非空，移除时只使用 count
+    struct RowRange {
+        int first;
+        int count;
+        QList<FileSystemNodePointer> nodes;
+    };
+
+    // 在 model 所在的线程中一次性应用整批的行变化，避免每插入/移除一行都要在两个线程间往返两次
+    bool commitInsertRanges(const QList<RowRange> &ranges)
+    {
+        if (ranges.isEmpty())
+            return true;
+
+        DThreadUtil::runInThread(&semaphore, model()->thread(), [&] {
+            const QModelIndex &parentIndex = model()->createIndex(rootNode, 0);
+
+            for (const RowRange &range : ranges) {
+                if (!enable)
+                    return;
+
+                model()->beginInsertRows(parentIndex, range.first, range.first + range.count - 1);
+
+                int row = range.first;
+
+                for (const FileSystemNodePointer &node : range.nodes)
+                    rootNode->insertChildren(row++, node->fileInfo->fileUrl(), node);
+
+                model()->endInsertRows();
+            }
+        });
+
+        return enable.load();
+    }
+
+    // ranges 需按行号从大到小排列，这样移除靠后的行时不影响前面行的行号
+    bool commitRemoveRanges(const QList<RowRange> &ranges)
+    {
+        if (ranges.isEmpty())
+            return true;
+
+        DThreadUtil::runInThread(&semaphore, model()->thread(), [&] {
+            const QModelIndex &parentIndex = model()->createIndex(rootNode, 0);
+
+            for (const RowRange &range : ranges) {
+                if (!enable)
+                    return;
+
+                if (!model()->beginRemoveRows(parentIndex, range.first, range.first + range.count - 1))
+                    continue;
+
+                for (int i = 0; i < range.count; ++i)
+                    Q_UNUSED(rootNode->takeNodeByIndex(range.first));
+
+                model()->endRemoveRows();
+            }
+        });
+
+        return enable.load();
+    }
+
     void run() override
     {
         // 缓存需要批量插入的文件信息列表
         QList<DAbstractFileInfoPointer> backlogFileInfoList;
         QList<DAbstractFileInfoPointer> backlogDirInfoList;
+        // 缓存需要按排序规则插入的文件和需要移除的文件，在一个时间窗口内合并为连续的行区间后统一提交
+        QList<QPair<DAbstractFileInfoPointer, DAbstractFileInfo::CompareFunction>> pendingSortedList;
+        QList<DUrl> pendingRemoveList;
         // 使用计时器避免文件在批量插入列表中等待太久
-        QTime timerOfFileList, timerOfDirList;
+        QTime timerOfFileList, timerOfDirList, timerOfPendingList;
 
         auto insertInfoList = [&] (int index, const QList<DAbstractFileInfoPointer> &list) {
-            DThreadUtil::runInThread(&semaphore, model()->thread(), model(), &DFileSystemModel::beginInsertRows,
-                                     model()->createIndex(rootNode, 0), index, index + list.count() - 1);
+            RowRange range { index, list.count(), {} };
 
-            if (!enable)
-                return false;
+            range.nodes.reserve(list.count());
 
             for (const DAbstractFileInfoPointer &fileInfo : list) {
                 if (!enable) {
                     return false;
                 }
 
-                FileSystemNodePointer node = model()->createNode(rootNode.data(), fileInfo);
-                rootNode->insertChildren(index++, fileInfo->fileUrl(), node);
+                range.nodes << model()->createNode(rootNode.data(), fileInfo);
             }
 
-            DThreadUtil::runInThread(&semaphore, model()->thread(), model(), &DFileSystemModel::endInsertRows);
-
-            return enable.load();
+            return commitInsertRanges({range});
         };
 
         auto disposeBacklogFileList = [&] {
@@ -467,30 +598,93 @@ private:
                 return true;
             }
 
-            int row = 0;
+            int row = rootNode->firstFileRow();
+
+            if (!insertInfoList(row, backlogDirInfoList))
+                return false;
+
+            backlogDirInfoList.clear();
+
+            return true;
+        };
+
+        auto disposePendingSortedList = [&] {
+            if (pendingSortedList.isEmpty()) {
+                return true;
+            }
+
+            const Qt::SortOrder order = model()->sortOrder();
+
+            // 先将这批文件自身排好序，则它们在当前列表中的插入位置是单调递增的，
+            // 第 i 个文件最终所在的行即为其插入位置加上排在它前面的新文件个数
+            std::stable_sort(pendingSortedList.begin(), pendingSortedList.end(),
+                             [order] (const QPair<DAbstractFileInfoPointer, DAbstractFileInfo::CompareFunction> &v1,
+                                      const QPair<DAbstractFileInfoPointer, DAbstractFileInfo::CompareFunction> &v2) {
+                return v1.second(v1.first, v2.first, order);
+            });
 
-            forever {
+            QList<RowRange> ranges;
+            int lastPosition = -1;
+
+            for (int i = 0; i < pendingSortedList.count(); ++i) {
                 if (!enable) {
                     return false;
                 }
 
-                if (row >= rootNode->childrenCount()) {
-                    break;
+                const auto &v = pendingSortedList.at(i);
+                int position = rootNode->sortedInsertRow(v.first, v.second, order);
+
+                if (ranges.isEmpty() || position != lastPosition) {
+                    ranges << RowRange { position + i, 0, {} };
+                    lastPosition = position;
                 }
 
-                const FileSystemNodePointer &node = rootNode->getNodeByIndex(row);
+                ranges.last().nodes << model()->createNode(rootNode.data(), v.first);
+                ++ranges.last().count;
+            }
 
-                if (node->fileInfo->isFile()) {
-                    break;
-                }
+            if (!commitInsertRanges(ranges))
+                return false;
+
+            pendingSortedList.clear();
 
-                ++row;
+            return true;
+        };
+
+        auto disposePendingRemoveList = [&] {
+            if (pendingRemoveList.isEmpty()) {
+                return true;
             }
 
-            if (!insertInfoList(row, backlogDirInfoList))
+            QList<int> rows;
+
+            rows.reserve(pendingRemoveList.count());
+
+            for (const DUrl &url : pendingRemoveList) {
+                int row = rootNode->indexOfChild(url);
+
+                if (row >= 0)
+                    rows << row;
+            }
+
+            std::sort(rows.begin(), rows.end(), std::greater<int>());
+            rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+            QList<RowRange> ranges;
+
+            for (int row : rows) {
+                if (!ranges.isEmpty() && ranges.last().first == row + 1) {
+                    --ranges.last().first;
+                    ++ranges.last().count;
+                } else {
+                    ranges << RowRange { row, 1, {} };
+                }
+            }
+
+            if (!commitRemoveRanges(ranges))
                 return false;
 
-            backlogDirInfoList.clear();
+            pendingRemoveList.clear();
 
             return true;
         };
@@ -507,6 +701,24 @@ private:
             return false;
         };
 
+        auto removeInPendingSortedList = [&] (const DUrl &url) {
+            for (int i = 0; i < pendingSortedList.count(); ++i) {
+                if (pendingSortedList.at(i).first->fileUrl() == url) {
+                    pendingSortedList.removeAt(i);
+
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        // 每个时间窗口最多提交一次，同一个窗口内的文件变化会被合并
+        auto pendingListIsFull = [&] {
+            return pendingSortedList.count() + pendingRemoveList.count() >= 1000
+                    || timerOfPendingList.elapsed() > 100;
+        };
+
 begin:
 
         while (!fileQueue.isEmpty()) {
@@ -518,45 +730,30 @@ begin:
             const DAbstractFileInfoPointer &fileInfo = v.second;
             const DUrl &fileUrl = fileInfo->fileUrl();
 
-            if (v.first == AddFile || v.first == AppendFile) {
-                if (rootNode->childContains(fileUrl))
-                    continue;
-
-                int row = -1;
-
-                if (model()->enabledSort()) {
-                    row = 0;
-
-                    if (fileInfo->hasOrderly() && v.first == AddFile) {
-                        DAbstractFileInfo::CompareFunction compareFun = fileInfo->compareFunByColumn(model()->sortRole());
+            if (pendingSortedList.isEmpty() && pendingRemoveList.isEmpty()) {
+                timerOfPendingList.start();
+            } else if (pendingListIsFull()) {
+                if (!disposePendingRemoveList() || !disposePendingSortedList())
+                    return;
 
-                        if (compareFun) {
-                            forever {
-                                if (!enable) {
-                                    return;
-                                }
+                timerOfPendingList.start();
+            }
 
-                                if (row >= rootNode->childrenCount()) {
-                                    break;
-                                }
+            if (v.first == AddFile || v.first == AppendFile) {
+                // 保证同一个文件先移除再添加的顺序
+                if (pendingRemoveList.contains(fileUrl) && !disposePendingRemoveList())
+                    return;
 
-                                const FileSystemNodePointer &node = rootNode->getNodeByIndex(row);
+                if (rootNode->childContains(fileUrl))
+                    continue;
 
-                                if (compareFun(fileInfo, node->fileInfo, model()->sortOrder())) {
-                                    break;
-                                }
+                DAbstractFileInfo::CompareFunction compareFun;
 
-                                ++row;
-                            }
-                        } else {
-                            row = -1;
-                        }
-                    } else {
-                        row = -1;
-                    }
+                if (model()->enabledSort() && fileInfo->hasOrderly() && v.first == AddFile) {
+                    compareFun = fileInfo->compareFunByColumn(model()->sortRole());
                 }
 
-                if (row < 0) {
+                if (!compareFun) {
                     bool isFile = fileInfo->isFile();
 
                     // 先加到待插入列表
@@ -579,22 +776,11 @@ begin:
 
                         backlogDirInfoList << fileInfo;
                     }
-                } else {
-                    if (!enable) {
-                        return;
-                    }
-
-                    DThreadUtil::runInThread(&semaphore, model()->thread(), model(), &DFileSystemModel::beginInsertRows,
-                                             model()->createIndex(rootNode, 0), row, row);
-
-                    if (!enable) {
-                        return;
-                    }
-
-                    FileSystemNodePointer node = model()->createNode(rootNode.data(), fileInfo);
-                    rootNode->insertChildren(row, fileUrl, node);
-
-                    DThreadUtil::runInThread(&semaphore, model()->thread(), model(), &DFileSystemModel::endInsertRows);
+                } else if (std::none_of(pendingSortedList.constBegin(), pendingSortedList.constEnd(),
+                                        [&fileUrl] (const QPair<DAbstractFileInfoPointer, DAbstractFileInfo::CompareFunction> &pending) {
+                               return pending.first->fileUrl() == fileUrl;
+                           })) {
+                    pendingSortedList << qMakePair(fileInfo, compareFun);
                 }
             } else {
                 // 先尝试从待插入列表中删除
@@ -606,29 +792,18 @@ begin:
                     continue;
                 }
 
-                int row = rootNode->indexOfChild(fileUrl);
-
-                if (!enable) {
-                    return;
-                }
-
-                if (row < 0) {
+                if (removeInPendingSortedList(fileUrl)) {
                     continue;
                 }
 
-                if (DThreadUtil::runInThread(&semaphore, model()->thread(), model(), &DFileSystemModel::beginRemoveRows,
-                                             model()->createIndex(rootNode, 0), row, row)) {
-                    if (!enable) {
-                        return;
-                    }
-
-                    Q_UNUSED(rootNode->takeNodeByIndex(row));
-                    DThreadUtil::runInThread(&semaphore, model()->thread(), model(), &DFileSystemModel::endRemoveRows);
-                }
+                pendingRemoveList << fileUrl;
             }
         }
 
         // 退出前确保所有文件都被处理
+        if (!disposePendingRemoveList() || !disposePendingSortedList())
+            return;
+
         disposeBacklogFileList();
         disposeBacklogDirList();
 
@@ -712,6 +887,8 @@ public:
     QStringList nameFilters;
     QDir::Filters filters;
     Qt::SortOrder srotOrder = Qt::AscendingOrder;
+    // 排序条件每改变一次加1，用于中止基于旧条件的排序
+    QAtomicInt sortGeneration;
 //    QModelIndex d->activeIndex;
 
     QPointer<JobController> jobController;
@@ -1656,6 +1833,7 @@ void DFileSystemModel::setSortRole(int role, Qt::SortOrder order)
 
     d->sortRole = role;
     d->srotOrder = order;
+    d->sortGeneration.ref();
 }
 
 void DFileSystemModel::setNameFilters(const QStringList &nameFilters)
@@ -1719,6 +1897,7 @@ void DFileSystemModel::setSortOrder(const Qt::SortOrder &order)
 {
     Q_D(DFileSystemModel);
     d->srotOrder = order;
+    d->sortGeneration.ref();
 }
 
 int DFileSystemModel::sortColumn() const
@@ -2028,8 +2207,12 @@ void DFileSystemModel::updateChildren(QList<DAbstractFileInfoPointer> list)
         fileList << chileNode.data();
     }
 
-    if (enabledSort())
-        sort(node->fileInfo, fileList);
+    int sortGeneration = d->sortGeneration.load();
+
+    // 排序条件在排序过程中改变时此次的结果会被丢弃，按新的条件重新排序
+    while (enabledSort() && !sort(node->fileInfo, fileList) && sortGeneration != d->sortGeneration.load()) {
+        sortGeneration = d->sortGeneration.load();
+    }
 
     beginInsertRows(createIndex(node, 0), 0, list.count() - 1);
 
@@ -2038,6 +2221,17 @@ void DFileSystemModel::updateChildren(QList<DAbstractFileInfoPointer> list)
 
     endInsertRows();
 
+    // 此时模型处于忙碌状态，sort() 不会响应排序条件的改变，插入前后条件已改变时在此重新排序
+    while (enabledSort() && sortGeneration != d->sortGeneration.load() && !d->needQuitUpdateChildren) {
+        sortGeneration = d->sortGeneration.load();
+        fileList = node->getChildrenList();
+
+        if (sort(node->fileInfo, fileList)) {
+            node->setChildrenList(fileList);
+            emitAllDataChanged();
+        }
+    }
+
     if (!d->jobController || d->jobController->isFinished()) {
         setState(Idle);
     } else {
@@ -2224,15 +2418,78 @@ bool DFileSystemModel::sort(const DAbstractFileInfoPointer &parentInfo, QList<Fi
         return false;
     }
 
+    // 先记下排序条件的版本再读取排序条件，排序条件在此之后改变时本次排序一定会被丢弃
+    const int sortGeneration = d->sortGeneration.load();
     DAbstractFileInfo::CompareFunction sortFun = parentInfo->compareFunByColumn(d->sortRole);
 
     if (!sortFun) {
         return false;
     }
 
-    qSort(list.begin(), list.end(), [sortFun, d](const FileSystemNode *node1, const FileSystemNode *node2) {
-        return sortFun(node1->fileInfo, node2->fileInfo, d->srotOrder);
-    });
+    const Qt::SortOrder order = d->srotOrder;
+
+    // 排序条件改变后让剩下的比较都立即返回，此次的排序结果会被丢弃
+    auto lessThan = [sortFun, order, sortGeneration, d] (const FileSystemNode *node1, const FileSystemNode *node2) {
+        if (d->sortGeneration.load() != sortGeneration)
+            return false;
+
+        return sortFun(node1->fileInfo, node2->fileInfo, order);
+    };
+
+    const int chunkCount = qMin(QThread::idealThreadCount(), list.count() / PARALLEL_SORT_MIN_CHUNK_SIZE);
+
+    if (chunkCount < 2) {
+        std::sort(list.begin(), list.end(), lessThan);
+    } else {
+        // 先分块并行排序，再将相邻的块两两并行归并
+        const QList<FileSystemNode*>::iterator begin = list.begin();
+        QList<QFuture<void>> futures;
+        QVector<int> bounds;
+
+        for (int i = 0; i <= chunkCount; ++i) {
+            bounds << int(qint64(list.count()) * i / chunkCount);
+        }
+
+        for (int i = 0; i < chunkCount; ++i) {
+            futures << QtConcurrent::run(QThreadPool::globalInstance(), [begin, bounds, lessThan, i] {
+                std::sort(begin + bounds.at(i), begin + bounds.at(i + 1), lessThan);
+            });
+        }
+
+        while (true) {
+            for (QFuture<void> &future : futures) {
+                future.waitForFinished();
+            }
+
+            futures.clear();
+
+            if (bounds.count() <= 2 || d->sortGeneration.load() != sortGeneration) {
+                break;
+            }
+
+            QVector<int> mergedBounds;
+
+            for (int i = 0; i + 2 < bounds.count(); i += 2) {
+                futures << QtConcurrent::run(QThreadPool::globalInstance(), [begin, bounds, lessThan, i] {
+                    std::inplace_merge(begin + bounds.at(i), begin + bounds.at(i + 1), begin + bounds.at(i + 2), lessThan);
+                });
+
+                mergedBounds << bounds.at(i);
+            }
+
+            // 块的个数为奇数时，最后一块留到下一轮再归并
+            if (bounds.count() % 2 == 0) {
+                mergedBounds << bounds.at(bounds.count() - 2);
+            }
+
+            mergedBounds << bounds.last();
+            bounds = mergedBounds;
+        }
+    }
+
+    if (d->sortGeneration.load() != sortGeneration) {
+        return false;
+    }
 
     if (columnIsCompact() && d->rootNode && d->rootNode->fileInfo) {
         int column = 0;
@@ -2372,68 +2629,24 @@ void DFileSystemModel::addFile(const DAbstractFileInfoPointer &fileInfo)
     const DUrl &fileUrl = fileInfo->fileUrl();
 
     if (parentNode && parentNode->populatedChildren && !parentNode->childContains(fileUrl)) {
-        QPointer<DFileSystemModel> me = this;
-
         int row = -1;
 
         if (enabledSort()) {
-            row = 0;
-
-            QFuture<void> result;
-
             if (fileInfo->hasOrderly()) {
                 DAbstractFileInfo::CompareFunction compareFun = fileInfo->compareFunByColumn(d->sortRole);
 
                 if (compareFun) {
-                    result = QtConcurrent::run(QThreadPool::globalInstance(), [&] {
-                        forever
-                        {
-                            if (!me || row >= parentNode->childrenCount()) {
-                                break;
-                            }
-
-                            const FileSystemNodePointer &node = parentNode->getNodeByIndex(row);
-
-                            if (compareFun(fileInfo, node->fileInfo, d->srotOrder)) {
-                                break;
-                            }
-
-                            ++row;
-                        }
-                    });
+                    row = parentNode->sortedInsertRow(fileInfo, compareFun, d->srotOrder);
                 } else {
                     row = -1;
                 }
             } else if (fileInfo->isFile()) {
                 row = -1;
             } else {
-                result = QtConcurrent::run(QThreadPool::globalInstance(), [&] {
-                    forever
-                    {
-                        if (!me || row >= parentNode->childrenCount()) {
-                            break;
-                        }
-
-                        const FileSystemNodePointer &node = parentNode->getNodeByIndex(row);
-
-                        if (node->fileInfo->isFile()) {
-                            break;
-                        }
-
-                        ++row;
-                    }
-                });
-            }
-
-            while (!result.isFinished()) {
-                qApp->processEvents();
+                row = parentNode->firstFileRow();
             }
         }
 
-        if (!me) {
-            return;
-        }
-
         if (row == -1) {
             row = parentNode->childrenCount();
         }
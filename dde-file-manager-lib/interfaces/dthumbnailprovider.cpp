@@ -36,10 +36,8 @@
 #include <QDir>
 #include <QDateTime>
 #include <QImageReader>
-#include <QQueue>
 #include <QMimeType>
 #include <QReadWriteLock>
-#include <QWaitCondition>
 #include <QPainter>
 #include <QDirIterator>
 #include <QJsonDocument>
@@ -47,6 +45,11 @@
 #include <QJsonArray>
 #include <QProcess>
 #include <QDebug>
+#include <QMutex>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QSharedPointer>
+#include <QtConcurrent>
 
 // use original poppler api
 #include <poppler-document.h>
@@ -65,44 +68,178 @@ inline QByteArray dataToMd5Hex(const QByteArray &data)
     return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
 }
 
+#define THUMBNAIL_TOOL_TIMEOUT 30000
+
+// 常驻的缩略图工具进程，使用 "--persistent" 参数启动，通过标准输入输出交换数据
+// 请求: qint32 缩略图大小, qint32 路径长度, 路径数据
+// 回复: qint32 状态(0为成功), qint32 数据长度, png图片数据(失败时为错误信息)
+class ThumbnailToolProcess
+{
+public:
+    explicit ThumbnailToolProcess(const QString &tool);
+    ~ThumbnailToolProcess();
+
+    bool request(int size, const QString &filePath, QByteArray &data, QString &errorString);
+
+private:
+    bool readData(qint64 size, QByteArray &data);
+
+    QString tool;
+    QProcess process;
+};
+
+ThumbnailToolProcess::ThumbnailToolProcess(const QString &tool)
+    : tool(tool)
+{
+    process.setStandardErrorFile(QProcess::nullDevice());
+}
+
+ThumbnailToolProcess::~ThumbnailToolProcess()
+{
+    if (process.state() == QProcess::NotRunning)
+        return;
+
+    // 关闭输入后工具进程会自动退出
+    process.closeWriteChannel();
+
+    if (!process.waitForFinished(1000)) {
+        process.kill();
+        process.waitForFinished(1000);
+    }
+}
+
+bool ThumbnailToolProcess::request(int size, const QString &filePath, QByteArray &data, QString &errorString)
+{
+    if (process.state() == QProcess::NotRunning) {
+        process.start(tool, {"--persistent"});
+
+        if (!process.waitForStarted()) {
+            errorString = process.errorString();
+
+            return false;
+        }
+    }
+
+    const QByteArray &path = filePath.toLocal8Bit();
+    const qint32 header[2] = {size, path.size()};
+
+    process.write(reinterpret_cast<const char*>(header), sizeof(header));
+    process.write(path);
+
+    QByteArray reply;
+
+    if (!process.waitForBytesWritten(THUMBNAIL_TOOL_TIMEOUT) || !readData(sizeof(header), reply)) {
+        errorString = QString("the \"%1\" application is not responding: %2").arg(tool, process.errorString());
+        // 结束无响应的进程，下次请求时重新启动
+        process.kill();
+        process.waitForFinished(1000);
+
+        return false;
+    }
+
+    qint32 status;
+    qint32 length;
+
+    memcpy(&status, reply.constData(), sizeof(status));
+    memcpy(&length, reply.constData() + sizeof(status), sizeof(length));
+
+    if (length < 0 || !readData(length, data)) {
+        errorString = QString("the \"%1\" application is not responding: %2").arg(tool, process.errorString());
+        process.kill();
+        process.waitForFinished(1000);
+
+        return false;
+    }
+
+    if (status != 0) {
+        errorString = data.isEmpty() ? QString("get thumbnail failed from the \"%1\" application").arg(tool)
+                                     : QString::fromLocal8Bit(data);
+        data.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool ThumbnailToolProcess::readData(qint64 size, QByteArray &data)
+{
+    while (process.bytesAvailable() < size) {
+        if (!process.waitForReadyRead(THUMBNAIL_TOOL_TIMEOUT))
+            return false;
+    }
+
+    data = process.read(size);
+
+    return true;
+}
+
 class DThumbnailProviderPrivate
 {
 public:
+    // 不同类型的文件由不同的线程池生成缩略图，避免耗时的文件占用所有的线程
+    enum MediaClass {
+        ImageClass,
+        DocumentClass,
+        ExternalClass, // 使用dtk或外部程序生成
+        MediaClassCount
+    };
+
+    typedef QPair<QString, DThumbnailProvider::Size> ProduceKey;
+
     DThumbnailProviderPrivate(DThumbnailProvider *qq);
 
     void init();
 
     QString sizeToFilePath(DThumbnailProvider::Size size) const;
+    MediaClass mediaClass(const QFileInfo &info) const;
+    void processProduceQueue(MediaClass mediaClass);
 
     DThumbnailProvider *q_ptr;
-    QString errorString;
+    // 每个线程的错误信息
+    QThreadStorage<QString> errorString;
     // 5MB
     qint64 defaultSizeLimit = 1024 * 1024 * 20;
     QHash<QMimeType, qint64> sizeLimitHash;
     DMimeDatabase mimeDatabase;
 
     static QSet<QString> hasThumbnailMimeHash;
+    static QReadWriteLock hasThumbnailMimeHashLock;
 
     struct ProduceInfo {
         QFileInfo fileInfo;
         DThumbnailProvider::Size size;
-        DThumbnailProvider::CallBack callback;
+        // 合并到此任务中的每次请求的标识和回调，取消请求时只移除对应的一项
+        QList<QPair<quint64, DThumbnailProvider::CallBack>> requests;
+        MediaClass mediaClass;
+        quint64 sequence;
     };
 
-    QQueue<ProduceInfo> produceQueue;
-    QSet<QPair<QString, DThumbnailProvider::Size>> discardedProduceInfos;
+    void removeRequest(const ProduceKey &key, quint64 requestId);
 
-    bool running = true;
+    // 相同文件的请求合并为一个任务，最后请求的文件（通常是当前可见的文件）最先处理
+    QHash<ProduceKey, ProduceInfo> produceInfos;
+    QMap<quint64, ProduceKey> produceQueues[MediaClassCount];
+    quint64 produceSequence = 0;
+    int activeWorkerCount[MediaClassCount] = {};
+    QThreadPool producePools[MediaClassCount];
+    QMutex dataLock;
 
-    QWaitCondition waitCondition;
-    QReadWriteLock dataReadWriteLock;
+    bool running = true;
 
     QHash<QString, QString> keyToThumbnailTool;
+    QSet<QString> persistentThumbnailTools;
+    QMutex thumbnailToolLock;
+    // dtk 的缩略图接口不是线程安全的，对它的调用需要串行执行
+    QMutex dtkProviderLock;
+    // 每个线程使用自己的工具进程，线程退出时结束
+    QThreadStorage<QHash<QString, QSharedPointer<ThumbnailToolProcess>>> thumbnailToolProcesses;
 
     Q_DECLARE_PUBLIC(DThumbnailProvider)
 };
 
 QSet<QString> DThumbnailProviderPrivate::hasThumbnailMimeHash;
+QReadWriteLock DThumbnailProviderPrivate::hasThumbnailMimeHashLock;
 
 DThumbnailProviderPrivate::DThumbnailProviderPrivate(DThumbnailProvider *qq)
     : q_ptr(qq)
@@ -128,6 +265,10 @@ void DThumbnailProviderPrivate::init()
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("image/jpeg"), 1024 * 1024 * 30);
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("image/png"), 1024 * 1024 * 30);
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("image/pipeg"), 1024 * 1024 * 30);
+
+    producePools[ImageClass].setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+    producePools[DocumentClass].setMaxThreadCount(2);
+    producePools[ExternalClass].setMaxThreadCount(2);
 }
 
 QString DThumbnailProviderPrivate::sizeToFilePath(DThumbnailProvider::Size size) const
@@ -144,6 +285,77 @@ QString DThumbnailProviderPrivate::sizeToFilePath(DThumbnailProvider::Size size)
     return QString();
 }
 
+DThumbnailProviderPrivate::MediaClass DThumbnailProviderPrivate::mediaClass(const QFileInfo &info) const
+{
+    // 只根据文件名判断，不读取文件内容
+    const QString &mime = mimeDatabase.mimeTypeForFile(info, QMimeDatabase::MatchExtension).name();
+
+    if (mime.startsWith("image/"))
+        return ImageClass;
+
+    if (mime == "text/plain" || mime == "application/pdf")
+        return DocumentClass;
+
+    return ExternalClass;
+}
+
+void DThumbnailProviderPrivate::processProduceQueue(MediaClass mediaClass)
+{
+    Q_Q(DThumbnailProvider);
+
+    forever {
+        QMutexLocker locker(&dataLock);
+        QMap<quint64, ProduceKey> &queue = produceQueues[mediaClass];
+
+        if (!running || queue.isEmpty()) {
+            --activeWorkerCount[mediaClass];
+
+            return;
+        }
+
+        const auto last = std::prev(queue.end());
+        const ProduceInfo task = produceInfos.take(last.value());
+
+        queue.erase(last);
+        locker.unlock();
+
+        const QString &thumbnail = q->createThumbnail(task.fileInfo, task.size);
+
+        for (const QPair<quint64, DThumbnailProvider::CallBack> &request : task.requests) {
+            if (request.second)
+                request.second(thumbnail);
+        }
+    }
+}
+
+void DThumbnailProviderPrivate::removeRequest(const ProduceKey &key, quint64 requestId)
+{
+    QMutexLocker locker(&dataLock);
+    auto produce_info = produceInfos.find(key);
+
+    if (produce_info == produceInfos.end() || produce_info->requests.isEmpty())
+        return;
+
+    // 请求标识为 0 时移除最后一次请求
+    int index = produce_info->requests.count() - 1;
+
+    if (requestId != 0) {
+        while (index >= 0 && produce_info->requests.at(index).first != requestId)
+            --index;
+
+        if (index < 0)
+            return;
+    }
+
+    produce_info->requests.removeAt(index);
+
+    // 所有请求都已取消时不再生成缩略图
+    if (produce_info->requests.isEmpty()) {
+        produceQueues[produce_info->mediaClass].remove(produce_info->sequence);
+        produceInfos.erase(produce_info);
+    }
+}
+
 class DFileThumbnailProviderPrivate : public DThumbnailProvider {};
 Q_GLOBAL_STATIC(DFileThumbnailProviderPrivate, ftpGlobal)
 
@@ -199,9 +411,15 @@ bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
         return false;
     }
 
+    QReadLocker locker(&DThumbnailProviderPrivate::hasThumbnailMimeHashLock);
+
     if (DThumbnailProviderPrivate::hasThumbnailMimeHash.contains(mime))
         return true;
 
+    locker.unlock();
+
+    QWriteLocker write_locker(&DThumbnailProviderPrivate::hasThumbnailMimeHashLock);
+
     if (Q_LIKELY(mime.startsWith("image") || mime.startsWith("video/"))) {
         DThumbnailProviderPrivate::hasThumbnailMimeHash.insert(mime);
 
@@ -218,6 +436,8 @@ bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
         return true;
     }
 
+    write_locker.unlock();
+
     if (DTK_WIDGET_NAMESPACE::DThumbnailProvider::instance()->hasThumbnail(mimeType))
         return true;
 
@@ -276,7 +496,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 {
     Q_D(DThumbnailProvider);
 
-    d->errorString.clear();
+    QString &errorString = d->errorString.localData();
+
+    errorString.clear();
 
     const QString &absolutePath = info.absolutePath();
     const QString &absoluteFilePath = info.absoluteFilePath();
@@ -289,7 +511,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
     }
 
     if (!hasThumbnail(info)) {
-        d->errorString = QStringLiteral("This file has not support thumbnail: ") + absoluteFilePath;
+        errorString = QStringLiteral("This file has not support thumbnail: ") + absoluteFilePath;
 
         //!Warnning: Do not store thumbnails to the fail path
         return QString();
@@ -320,14 +542,14 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QImageReader reader(absoluteFilePath, mime.preferredSuffix().toLatin1());
 
         if (!reader.canRead()) {
-            d->errorString = reader.errorString();
+            errorString = reader.errorString();
             goto _return;
         }
 
         const QSize &imageSize = reader.size();
 
 //        if(!imageSize.isValid()){
-//            d->errorString = "Fail to read image file attribute data:" + info.absoluteFilePath();
+//            errorString = "Fail to read image file attribute data:" + info.absoluteFilePath();
 //            goto _return;
 //        }
 
@@ -336,7 +558,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         }
 
         if (!reader.read(image.data())) {
-            d->errorString = reader.errorString();
+            errorString = reader.errorString();
             goto _return;
         }
 
@@ -348,7 +570,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QFile file(absoluteFilePath);
 
         if (!file.open(QIODevice::ReadOnly)) {
-            d->errorString = file.errorString();
+            errorString = file.errorString();
             goto _return;
         }
 
@@ -377,19 +599,19 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QScopedPointer<poppler::document> doc(poppler::document::load_from_file(absoluteFilePath.toStdString()));
 
         if (!doc || doc->is_locked()) {
-            d->errorString = QStringLiteral("Cannot read this pdf file: ") + absoluteFilePath;
+            errorString = QStringLiteral("Cannot read this pdf file: ") + absoluteFilePath;
             goto _return;
         }
 
         if (doc->pages() < 1) {
-            d->errorString = QStringLiteral("This stream is invalid");
+            errorString = QStringLiteral("This stream is invalid");
             goto _return;
         }
 
         QScopedPointer<const poppler::page> page(doc->create_page(0));
 
         if (!page) {
-            d->errorString = QStringLiteral("Cannot get this page at index 0");
+            errorString = QStringLiteral("Cannot get this page at index 0");
             goto _return;
         }
 
@@ -400,7 +622,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         poppler::image imageData = pr.render_page(page.data(), 72, 72, -1, -1, -1, size);
 
         if (!imageData.is_valid()) {
-            d->errorString = QStringLiteral("Render error");
+            errorString = QStringLiteral("Render error");
             goto _return;
         }
 
@@ -409,7 +631,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
         switch (format) {
         case poppler::image::format_invalid:
-            d->errorString = QStringLiteral("Image format is invalid");
+            errorString = QStringLiteral("Image format is invalid");
             goto _return;
         case poppler::image::format_mono:
             img = QImage((uchar*)imageData.data(), imageData.width(), imageData.height(), QImage::Format_Mono);
@@ -425,21 +647,25 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         }
 
         if (img.isNull()) {
-            d->errorString = QStringLiteral("Render error");
+            errorString = QStringLiteral("Render error");
             goto _return;
         }
 
         *image = img.scaled(QSize(size, size), Qt::KeepAspectRatio, Qt::SmoothTransformation);
     } else {
+        d->dtkProviderLock.lock();
         thumbnail = DTK_WIDGET_NAMESPACE::DThumbnailProvider::instance()->createThumbnail(info, (DTK_WIDGET_NAMESPACE::DThumbnailProvider::Size)size);
-        d->errorString = DTK_WIDGET_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        errorString = DTK_WIDGET_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        d->dtkProviderLock.unlock();
 
-        if (d->errorString.isEmpty()) {
+        if (errorString.isEmpty()) {
             emit createThumbnailFinished(absoluteFilePath, thumbnail);
             emit thumbnailChanged(absoluteFilePath, thumbnail);
 
             return thumbnail;
         } else { // fallback to thumbnail tool
+            QMutexLocker locker(&d->thumbnailToolLock);
+
             if (d->keyToThumbnailTool.isEmpty()) {
                 d->keyToThumbnailTool["Initialized"] = QString();
 
@@ -460,13 +686,18 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                         const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
                         file.close();
 
-                        const QStringList keys = document.object().toVariantMap().value("Keys").toStringList();
+                        const QVariantMap &tool_info = document.object().toVariantMap();
+                        const QStringList keys = tool_info.value("Keys").toStringList();
                         const QString &tool_file_path = file_info.absoluteDir().filePath(file_info.baseName());
 
                         if (!QFile::exists(tool_file_path)) {
                             continue;
                         }
 
+                        if (tool_info.value("Persistent").toBool()) {
+                            d->persistentThumbnailTools << tool_file_path;
+                        }
+
                         for (const QString &key : keys) {
                             if (d->keyToThumbnailTool.contains(key))
                                 continue;
@@ -485,45 +716,68 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 tool = d->keyToThumbnailTool.value(mime_name);
             }
 
+            const bool persistent_tool = d->persistentThumbnailTools.contains(tool);
+
+            locker.unlock();
+
             if (tool.isEmpty()) {
                 return thumbnail;
             }
 
-            QProcess process;
-            process.start(tool, {QString::number(size), absoluteFilePath}, QIODevice::ReadOnly);
+            QByteArray png_data;
 
-            if (!process.waitForFinished()) {
-                d->errorString = process.errorString();
+            if (persistent_tool) {
+                QSharedPointer<ThumbnailToolProcess> &tool_process = d->thumbnailToolProcesses.localData()[tool];
 
-                goto _return;
-            }
+                if (!tool_process)
+                    tool_process.reset(new ThumbnailToolProcess(tool));
+
+                if (!tool_process->request(size, absoluteFilePath, png_data, errorString)) {
+                    goto _return;
+                }
+            } else {
+                QProcess process;
+                process.start(tool, {QString::number(size), absoluteFilePath}, QIODevice::ReadOnly);
 
-            if (process.exitCode() != 0) {
-                const QString &error = process.readAllStandardError();
+                if (!process.waitForFinished()) {
+                    errorString = process.errorString();
 
-                if (error.isEmpty()) {
-                    d->errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
-                } else {
-                    d->errorString = error;
+                    goto _return;
                 }
 
-                goto _return;
+                if (process.exitCode() != 0) {
+                    const QString &error = process.readAllStandardError();
+
+                    if (error.isEmpty()) {
+                        errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
+                    } else {
+                        errorString = error;
+                    }
+
+                    goto _return;
+                }
+
+                png_data = process.readAllStandardOutput();
+
+                // 兼容输出base64数据的工具
+                if (!png_data.startsWith("\x89PNG")) {
+                    png_data = QByteArray::fromBase64(png_data);
+                }
             }
 
-            const QByteArray png_data = QByteArray::fromBase64(process.readAllStandardOutput());
             Q_ASSERT(!png_data.isEmpty());
 
             if (image->loadFromData(png_data, "png")) {
-                d->errorString.clear();
+                errorString.clear();
             } else {
-                d->errorString = QString("load png image failed from the \"%1\" application").arg(tool);
+                errorString = QString("load png image failed from the \"%1\" application").arg(tool);
             }
         }
     }
 
 _return:
     // successful
-    if (d->errorString.isEmpty()) {
+    if (errorString.isEmpty()) {
         thumbnail = d->sizeToFilePath(size) + QDir::separator() + thumbnailName;
     } else {
         //fail
@@ -537,10 +791,10 @@ _return:
     QFileInfo(thumbnail).absoluteDir().mkpath(".");
 
     if (!image->save(thumbnail, Q_NULLPTR, 80)) {
-        d->errorString = QStringLiteral("Can not save image to ") + thumbnail;
+        errorString = QStringLiteral("Can not save image to ") + thumbnail;
     }
 
-    if (d->errorString.isEmpty()) {
+    if (errorString.isEmpty()) {
         emit createThumbnailFinished(absoluteFilePath, thumbnail);
         emit thumbnailChanged(absoluteFilePath, thumbnail);
 
@@ -553,44 +807,68 @@ _return:
     return QString();
 }
 
-void DThumbnailProvider::appendToProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size, DThumbnailProvider::CallBack callback)
+quint64 DThumbnailProvider::appendToProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size, DThumbnailProvider::CallBack callback)
 {
-    DThumbnailProviderPrivate::ProduceInfo produceInfo;
+    Q_D(DThumbnailProvider);
 
-    produceInfo.fileInfo = info;
-    produceInfo.size = size;
-    produceInfo.callback = callback;
+    const DThumbnailProviderPrivate::ProduceKey key(info.absoluteFilePath(), size);
+    const DThumbnailProviderPrivate::MediaClass media_class = d->mediaClass(info);
 
-    Q_D(DThumbnailProvider);
+    QMutexLocker locker(&d->dataLock);
 
-    if (isRunning()) {
-        QWriteLocker locker(&d->dataReadWriteLock);
-        d->produceQueue.append(std::move(produceInfo));
-        locker.unlock();
-        d->waitCondition.wakeAll();
+    if (!d->running)
+        return 0;
+
+    auto produce_info = d->produceInfos.find(key);
+
+    if (produce_info == d->produceInfos.end()) {
+        DThumbnailProviderPrivate::ProduceInfo new_produce_info;
+
+        new_produce_info.fileInfo = info;
+        new_produce_info.size = size;
+        new_produce_info.mediaClass = media_class;
+        produce_info = d->produceInfos.insert(key, new_produce_info);
     } else {
-        d->produceQueue.append(std::move(produceInfo));
-        start();
+        // 再次请求时提高优先级
+        d->produceQueues[produce_info->mediaClass].remove(produce_info->sequence);
+    }
+
+    produce_info->sequence = ++d->produceSequence;
+    produce_info->requests << qMakePair(produce_info->sequence, callback);
+    d->produceQueues[produce_info->mediaClass].insert(produce_info->sequence, key);
+
+    const DThumbnailProviderPrivate::MediaClass worker_class = produce_info->mediaClass;
+
+    if (d->activeWorkerCount[worker_class] < d->producePools[worker_class].maxThreadCount()) {
+        ++d->activeWorkerCount[worker_class];
+        QtConcurrent::run(&d->producePools[worker_class], [d, worker_class] {
+            d->processProduceQueue(worker_class);
+        });
     }
+
+    // 以此次请求的序号作为请求的标识
+    return produce_info->sequence;
 }
 
 void DThumbnailProvider::removeInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size)
 {
     Q_D(DThumbnailProvider);
 
-    if (isRunning()) {
-        QWriteLocker locker(&d->dataReadWriteLock);
-        Q_UNUSED(locker)
-    }
+    d->removeRequest(qMakePair(info.absoluteFilePath(), size), 0);
+}
 
-    d->discardedProduceInfos.insert(qMakePair(info.absoluteFilePath(), size));
+void DThumbnailProvider::removeInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size, quint64 requestId)
+{
+    Q_D(DThumbnailProvider);
+
+    d->removeRequest(qMakePair(info.absoluteFilePath(), size), requestId);
 }
 
 QString DThumbnailProvider::errorString() const
 {
     Q_D(const DThumbnailProvider);
 
-    return d->errorString;
+    return d->errorString.localData();
 }
 
 qint64 DThumbnailProvider::defaultSizeLimit() const
@@ -632,41 +910,24 @@ DThumbnailProvider::~DThumbnailProvider()
 {
     Q_D(DThumbnailProvider);
 
+    d->dataLock.lock();
     d->running = false;
-    d->waitCondition.wakeAll();
-    wait();
-}
-
-void DThumbnailProvider::run()
-{
-    Q_D(DThumbnailProvider);
-
-    forever {
-        QWriteLocker locker(&d->dataReadWriteLock);
-
-        if (d->produceQueue.isEmpty()) {
-            d->waitCondition.wait(&d->dataReadWriteLock);
-        }
-
-        if (!d->running)
-            return;
-
-        const DThumbnailProviderPrivate::ProduceInfo &task = d->produceQueue.dequeue();
-        const QPair<QString, DThumbnailProvider::Size> &tmpKey = qMakePair(task.fileInfo.absoluteFilePath(), task.size);
+    d->produceInfos.clear();
 
-        if (d->discardedProduceInfos.contains(tmpKey)) {
-            d->discardedProduceInfos.remove(tmpKey);
-            locker.unlock();
-            continue;
-        }
-
-        locker.unlock();
+    for (QMap<quint64, DThumbnailProviderPrivate::ProduceKey> &queue : d->produceQueues) {
+        queue.clear();
+    }
 
-        const QString &thumbnail = createThumbnail(task.fileInfo, task.size);
+    d->dataLock.unlock();
 
-        if (task.callback)
-            task.callback(thumbnail);
+    for (QThreadPool &pool : d->producePools) {
+        pool.waitForDone();
     }
 }
 
+void DThumbnailProvider::run()
+{
+    // 缩略图在各类型的线程池中生成，不再需要此线程
+}
+
 DFM_END_NAMESPACE
@@ -59,8 +59,9 @@ public:
 
     QString createThumbnail(const QFileInfo &info, Size size);
     typedef std::function<void(const QString&)> CallBack;
-    void appendToProduceQueue(const QFileInfo &info, Size size, CallBack callback = 0);
+    quint64 appendToProduceQueue(const QFileInfo &info, Size size, CallBack callback = 0);
     void removeInProduceQueue(const QFileInfo &info, Size size);
+    void removeInProduceQueue(const QFileInfo &info, Size size, quint64 requestId);
 
     QString errorString() const;
 
@@ -70,7 +70,8 @@ DUrl::DUrl(const QUrl &copy)
 
 DUrl::DUrl(const DUrl &other)
     : QUrl{other},
-      m_virtualPath{other.m_virtualPath}
+      m_virtualPath{other.m_virtualPath},
+      m_hash{other.m_hash.load()}
 
 {
     //###copy constructor
@@ -79,9 +80,11 @@ DUrl::DUrl(const DUrl &other)
 
 DUrl::DUrl(DUrl &&other)
     : QUrl{ std::move(other) },
-      m_virtualPath{ std::move(other.m_virtualPath) }
+      m_virtualPath{ std::move(other.m_virtualPath) },
+      m_hash{ other.m_hash.load() }
 {
     //###move constructor
+    other.m_hash.store(0);
 }
 
 
@@ -90,6 +93,7 @@ DUrl &DUrl::operator=(const DUrl &other)
 {
     QUrl::operator=(other);
     m_virtualPath = other.m_virtualPath;
+    m_hash.store(other.m_hash.load());
 
     return *this;
 }
@@ -100,6 +104,8 @@ DUrl &DUrl::operator=(DUrl &&other)
 {
     QUrl::operator=(std::move(other));
     m_virtualPath = std::move(other.m_virtualPath);
+    m_hash.store(other.m_hash.load());
+    other.m_hash.store(0);
 
     return *this;
 }
@@ -144,6 +150,67 @@ void DUrl::setUrl(const QString &url, QUrl::ParsingMode parsingMode, bool makeAb
     updateVirtualPath();
 }
 
+void DUrl::setQuery(const QString &query, QUrl::ParsingMode mode)
+{
+    QUrl::setQuery(query, mode);
+    m_hash.store(0);
+}
+
+void DUrl::setQuery(const QUrlQuery &query)
+{
+    QUrl::setQuery(query);
+    m_hash.store(0);
+}
+
+void DUrl::setFragment(const QString &fragment, QUrl::ParsingMode mode)
+{
+    QUrl::setFragment(fragment, mode);
+    m_hash.store(0);
+}
+
+void DUrl::setHost(const QString &host, QUrl::ParsingMode mode)
+{
+    QUrl::setHost(host, mode);
+    m_hash.store(0);
+}
+
+void DUrl::setUserName(const QString &userName, QUrl::ParsingMode mode)
+{
+    QUrl::setUserName(userName, mode);
+    m_hash.store(0);
+}
+
+void DUrl::setPassword(const QString &password, QUrl::ParsingMode mode)
+{
+    QUrl::setPassword(password, mode);
+    m_hash.store(0);
+}
+
+void DUrl::setUserInfo(const QString &userInfo, QUrl::ParsingMode mode)
+{
+    QUrl::setUserInfo(userInfo, mode);
+    m_hash.store(0);
+}
+
+void DUrl::setAuthority(const QString &authority, QUrl::ParsingMode mode)
+{
+    QUrl::setAuthority(authority, mode);
+    m_hash.store(0);
+}
+
+void DUrl::setPort(int port)
+{
+    QUrl::setPort(port);
+    m_hash.store(0);
+}
+
+void DUrl::clear()
+{
+    QUrl::clear();
+    m_virtualPath.clear();
+    m_hash.store(0);
+}
+
 bool DUrl::isTrashFile() const
 {
     return scheme() == TRASH_SCHEME;
@@ -357,7 +424,7 @@ void DUrl::setSearchedFileUrl(const DUrl &url)
 void DUrl::setTaggedFileUrl(const QString& localFilePath) noexcept
 {
     if (this->isTaggedFile()) {
-        this->QUrl::setFragment(localFilePath, QUrl::DecodedMode);
+        this->setFragment(localFilePath, QUrl::DecodedMode);
     }
 }
 
@@ -575,6 +642,7 @@ DUrl DUrl::fromUserInput(const QString &userInput, QString workingDirectory,
             DUrl url;
 
             url.m_virtualPath = userInput;
+            url.m_hash.store(0);
 
             return url;
         }
@@ -663,8 +731,15 @@ bool DUrl::operator ==(const DUrl &url) const
         return QUrl::operator ==(url);
     }
 
-    QString path1 = m_virtualPath;
-    QString path2 = url.m_virtualPath;
+    // 哈希值都已计算过时，先比较哈希值
+    const quint64 hash1 = m_hash.load();
+    const quint64 hash2 = url.m_hash.load();
+
+    if (hash1 && hash2 && hash1 != hash2)
+        return false;
+
+    const QString &path1 = m_virtualPath;
+    const QString &path2 = url.m_virtualPath;
 
     return  path1 == path2 &&
             scheme() == url.scheme() &&
@@ -732,6 +807,30 @@ void DUrl::updateVirtualPath()
     if (m_virtualPath.endsWith('/') && m_virtualPath.count() != 1) {
         m_virtualPath.remove(m_virtualPath.count() - 1, 1);
     }
+
+    m_hash.store(0);
+}
+
+uint DUrl::hashValue() const
+{
+    quint64 hash = m_hash.load();
+
+    if (hash)
+        return static_cast<uint>(hash);
+
+    // 与种子无关的部分，种子在 qHash 中合并
+    hash = qHash(scheme()) ^
+           qHash(userName()) ^
+           qHash(password()) ^
+           qHash(host()) ^
+           qHash(port()) ^
+           qHash(m_virtualPath) ^
+           qHash(query()) ^
+           qHash(fragment());
+
+    m_hash.store(hash | (Q_UINT64_C(1) << 32));
+
+    return static_cast<uint>(hash);
 }
 
 QT_BEGIN_NAMESPACE
@@ -747,14 +846,7 @@ QDebug operator<<(QDebug deg, const DUrl &url)
 }
 
 uint qHash(const DUrl &url, uint seed) Q_DECL_NOTHROW {
-    return qHash(url.scheme()) ^
-    qHash(url.userName()) ^
-    qHash(url.password()) ^
-    qHash(url.host()) ^
-    qHash(url.port(), seed) ^
-    qHash(url.m_virtualPath) ^
-    qHash(url.query()) ^
-    qHash(url.fragment());
+    return url.hashValue() ^ seed;
 }
 QT_END_NAMESPACE
 
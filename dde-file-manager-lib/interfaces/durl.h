@@ -27,6 +27,7 @@
 
 #include <QUrl>
 #include <QMetaType>
+#include <QAtomicInteger>
 
 
 #define TRASH_SCHEME "trash"
@@ -93,6 +94,18 @@ public:
     void setScheme(const QString &scheme, bool makeAbsolutePath = true);
     void setUrl(const QString &url, ParsingMode parsingMode = TolerantMode, bool makeAbsolutePath = true);
 
+    // 以下函数会修改参与计算哈希值的部分，覆盖QUrl的函数以清除缓存的哈希值
+    void setQuery(const QString &query, ParsingMode mode = TolerantMode);
+    void setQuery(const QUrlQuery &query);
+    void setFragment(const QString &fragment, ParsingMode mode = TolerantMode);
+    void setHost(const QString &host, ParsingMode mode = DecodedMode);
+    void setUserName(const QString &userName, ParsingMode mode = DecodedMode);
+    void setPassword(const QString &password, ParsingMode mode = DecodedMode);
+    void setUserInfo(const QString &userInfo, ParsingMode mode = TolerantMode);
+    void setAuthority(const QString &authority, ParsingMode mode = TolerantMode);
+    void setPort(int port);
+    void clear();
+
     bool isTrashFile() const;
     bool isRecentFile() const;
     bool isBookMarkFile() const;
@@ -171,8 +184,11 @@ public:
 
 private:
     void updateVirtualPath();
+    uint hashValue() const;
 
     QString m_virtualPath;
+    // 缓存的哈希值，高位为1时有效，为0时需要重新计算
+    mutable QAtomicInteger<quint64> m_hash;
 };
 
 typedef QList<DUrl> DUrlList;
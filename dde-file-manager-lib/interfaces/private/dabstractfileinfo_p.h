@@ -14,13 +14,17 @@
 #include "dmimedatabase.h"
 
 #include <QPointer>
-
-QT_BEGIN_NAMESPACE
-class QReadWriteLock;
-QT_END_NAMESPACE
+#include <QMutex>
+#include <QCollatorSortKey>
 
 DFM_USE_NAMESPACE
 
+struct FileDisplayNameSortKey
+{
+    QCollatorSortKey key;
+    bool startWithHanzi;
+};
+
 class DAbstractFileInfoPrivate
 {
 public:
@@ -28,11 +32,17 @@ public:
     virtual ~DAbstractFileInfoPrivate();
 
     void setUrl(const DUrl &url, bool hasCache);
-    static DAbstractFileInfo *getFileInfo(const DUrl &fileUrl);
+    static DAbstractFileInfoPointer getFileInfo(const DUrl &fileUrl);
+    void clearSortKey() const;
 
     DAbstractFileInfo *q_ptr = Q_NULLPTR;
 
     mutable QString pinyinName;
+
+    // 按名称排序时使用的排序键，第一次比较时生成，刷新文件信息或 url 改变时清除。
+    // 并行排序时多个线程会同时读取它，读取时在锁内复制一份（QCollatorSortKey 为隐式共享）
+    mutable QScopedPointer<FileDisplayNameSortKey> sortKey;
+    mutable QMutex sortKeyMutex;
     bool active = false;
 
     DAbstractFileInfoPointer proxy;
@@ -44,8 +54,8 @@ public:
 
 private:
     DUrl fileUrl;
-    static QReadWriteLock *urlToFileInfoMapLock;
-    static QMap<DUrl, DAbstractFileInfo*> urlToFileInfoMap;
+    // 是否已加入缓存，未加入时析构无需访问缓存
+    bool cached = false;
 };
 
 #endif // DABSTRACTFILEINFO_P_H
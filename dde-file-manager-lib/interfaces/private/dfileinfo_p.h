@@ -35,6 +35,8 @@ public:
     mutable bool iconFromTheme = false;
     mutable QPointer<QTimer> getIconTimer;
     bool requestingThumbnail = false;
+    // 请求缩略图时得到的标识，取消时只取消自己的请求
+    quint64 thumbnailRequestId = 0;
     mutable bool needThumbnail = false;
     // 小于0时表示此值未初始化，0表示不支持，1表示支持
     mutable qint8 hasThumbnail = -1;
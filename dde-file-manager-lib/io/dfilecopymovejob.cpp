@@ -30,13 +30,32 @@
 #include "dlocalfiledevice.h"
 
 #include <QMutex>
+#include <QSemaphore>
 #include <QTimer>
 #include <QLoggingCategory>
-#include <QProcess>
+#include <QHash>
+#include <QtConcurrent/QtConcurrent>
 
 #include <unistd.h>
 #include <zlib.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#endif
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+// 不超过此大小的文件在复制目录时会被并行复制
+#define SMALL_FILE_SIZE (1024 * 1024)
+// 复制大文件时预读的数据块个数
+#define READ_AHEAD_BLOCK_COUNT 4
 
 DFM_BEGIN_NAMESPACE
 
@@ -46,51 +65,76 @@ Q_LOGGING_CATEGORY(fileJob, "file.job")
 Q_LOGGING_CATEGORY(fileJob, "file.job", QtInfoMsg)
 #endif
 
-#if defined(Q_OS_LINUX) && (defined(__GLIBC__) || QT_HAS_INCLUDE(<sys/syscall.h>))
-#  include <sys/syscall.h>
-
-# if defined(Q_OS_ANDROID) && !defined(SYS_gettid)
-#  define SYS_gettid __NR_gettid
-# endif
+// 挂载的块设备在 sysfs 中的信息，同一个设备只解析一次
+struct BlockDeviceInfo {
+    dev_t devNumber = 0;
+    // /sys/dev/block/x:x
+    QByteArray sysDevPath;
+    bool removable = false;
+};
 
-static long qt_gettid()
+static QByteArray readSysfsValue(const QByteArray &path)
 {
-    // no error handling
-    // this syscall has existed since Linux 2.4.11 and cannot fail
-    return syscall(SYS_gettid);
-}
-#elif defined(Q_OS_DARWIN)
-#  include <pthread.h>
-static int qt_gettid()
-{
-    // no error handling: this call cannot fail
-    __uint64_t tid;
-    pthread_threadid_np(NULL, &tid);
-    return tid;
-}
-#elif defined(Q_OS_FREEBSD_KERNEL) && defined(__FreeBSD_version) && __FreeBSD_version >= 900031
-#  include <pthread_np.h>
-static int qt_gettid()
-{
-    return pthread_getthreadid_np();
-}
-#else
-static QT_PREPEND_NAMESPACE(qint64) qt_gettid()
-{
-    QT_USE_NAMESPACE
-    return qintptr(QThread::currentThreadId());
+    char buffer[64];
+    int fd = open(path.constData(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return QByteArray();
+    }
+
+    ssize_t size = read(fd, buffer, sizeof(buffer));
+    close(fd);
+
+    return size > 0 ? QByteArray(buffer, int(size)).trimmed() : QByteArray();
 }
-#endif
 
-static QByteArray fileReadAll(const QString &file_path)
+static bool blockDeviceInfo(const QByteArray &devicePath, BlockDeviceInfo *info)
 {
-    QFile file(file_path);
+    static QMutex mutex;
+    static QHash<QByteArray, BlockDeviceInfo> cache;
 
-    if (file.open(QIODevice::ReadOnly)) {
-        return file.readAll();
+    struct stat device_stat;
+
+    if (stat(devicePath.constData(), &device_stat) != 0 || !S_ISBLK(device_stat.st_mode)) {
+        return false;
     }
 
-    return QByteArray();
+    QMutexLocker locker(&mutex);
+    auto cached = cache.constFind(devicePath);
+
+    // 设备号变化说明设备已被重新插入，需要重新解析
+    if (cached != cache.constEnd() && cached->devNumber == device_stat.st_rdev) {
+        *info = *cached;
+
+        return true;
+    }
+
+    locker.unlock();
+
+    BlockDeviceInfo new_info;
+
+    new_info.devNumber = device_stat.st_rdev;
+    new_info.sysDevPath = "/sys/dev/block/" + QByteArray::number(major(device_stat.st_rdev))
+                          + ":" + QByteArray::number(minor(device_stat.st_rdev));
+
+    char real_path[PATH_MAX];
+
+    if (realpath(new_info.sysDevPath.constData(), real_path)) {
+        const QByteArray device_dir(real_path);
+        // 分区的 removable 属性在其所属的磁盘目录中
+        const QByteArray disk_dir = QFile::exists(device_dir + "/partition")
+                                    ? device_dir.left(device_dir.lastIndexOf('/'))
+                                    : device_dir;
+
+        // 与 lsblk 的 HOTPLUG 一致，USB 设备也视为热插拔设备
+        new_info.removable = readSysfsValue(disk_dir + "/removable") == "1" || disk_dir.contains("/usb");
+    }
+
+    locker.relock();
+    cache[devicePath] = new_info;
+    *info = new_info;
+
+    return true;
 }
 
 class ElapsedTimer
@@ -144,15 +188,226 @@ private:
     QElapsedTimer timer;
 };
 
+// 在线程池中复制一个本地小文件，任何一步失败都会删除已创建的目标文件并返回 false，
+// 之后由任务线程按普通的流程重新复制，这样错误仍由任务线程统一处理
+static bool copyLocalSmallFile(const QByteArray &fromPath, const QByteArray &toPath, bool integrityChecking)
+{
+    int from_fd = open(fromPath.constData(), O_RDONLY | O_CLOEXEC);
+
+    if (from_fd < 0) {
+        return false;
+    }
+
+    struct stat from_stat;
+
+    if (fstat(from_fd, &from_stat) != 0 || !S_ISREG(from_stat.st_mode) || from_stat.st_size > SMALL_FILE_SIZE) {
+        close(from_fd);
+
+        return false;
+    }
+
+    // 完整性校验时需要从目标文件中读回写入的数据
+    int to_fd = open(toPath.constData(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+    if (to_fd < 0) {
+        close(from_fd);
+
+        return false;
+    }
+
+    QByteArray data(int(from_stat.st_size) + 1, Qt::Uninitialized);
+    qint64 size = 0;
+    bool ok = true;
+
+    // 文件大小可能在复制过程中改变，读取到文件末尾为止
+    Q_FOREVER {
+        if (size == data.size()) {
+            data.resize(data.size() * 2);
+        }
+
+        ssize_t size_read = read(from_fd, data.data() + size, size_t(data.size() - size));
+
+        if (size_read == 0) {
+            break;
+        }
+
+        if (size_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            ok = false;
+            break;
+        }
+
+        size += size_read;
+    }
+
+    for (qint64 written = 0; ok && written < size;) {
+        ssize_t size_write = write(to_fd, data.constData() + written, size_t(size - written));
+
+        if (size_write < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (size_write <= 0) {
+            ok = false;
+            break;
+        }
+
+        written += size_write;
+    }
+
+    if (ok && integrityChecking) {
+        QByteArray target_data(int(size) + 1, Qt::Uninitialized);
+        ssize_t size_read = pread(to_fd, target_data.data(), size_t(target_data.size()), 0);
+
+        ok = size_read == size && memcmp(data.constData(), target_data.constData(), size_t(size)) == 0;
+    }
+
+    if (ok) {
+        const struct timespec times[2] = {from_stat.st_atim, from_stat.st_mtim};
+
+        fchmod(to_fd, from_stat.st_mode & 07777);
+        futimens(to_fd, times);
+    }
+
+    close(from_fd);
+
+    if (close(to_fd) != 0) {
+        ok = false;
+    }
+
+    if (!ok) {
+        unlink(toPath.constData());
+    }
+
+    return ok;
+}
+
+// 在独立线程中提前读取源文件，与写入目标文件同时进行，读出的数据块的校验值也在读取线程中计算
+class BlockReader
+{
+public:
+    struct Block {
+        QByteArray data;
+        qint64 pos = 0;
+        // 小于等于0时表示已读到文件末尾或读取出错
+        qint64 size = 0;
+        bool atEnd = false;
+        uLong checksum = 0;
+    };
+
+    BlockReader(QIODevice *device, int blockSize, bool checksum, QThreadPool *pool)
+        : m_device(device)
+        , m_checksum(checksum)
+        , m_pool(pool)
+        , m_freeBlocks(READ_AHEAD_BLOCK_COUNT)
+    {
+        for (Block &block : m_blocks) {
+            block.data.resize(blockSize);
+        }
+    }
+
+    ~BlockReader()
+    {
+        stop();
+    }
+
+    // 从设备的当前位置开始读取
+    void start()
+    {
+        m_stop.store(0);
+        m_future = QtConcurrent::run(m_pool, [this] {
+            run();
+        });
+    }
+
+    void stop()
+    {
+        m_stop.store(1);
+        m_freeBlocks.release();
+        m_future.waitForFinished();
+
+        m_freeBlocks.acquire(m_freeBlocks.available());
+        m_freeBlocks.release(READ_AHEAD_BLOCK_COUNT);
+        m_usedBlocks.acquire(m_usedBlocks.available());
+        m_readIndex = 0;
+        m_writeIndex = 0;
+    }
+
+    // 返回的数据块在调用 release 前一直有效
+    const Block &take()
+    {
+        m_usedBlocks.acquire();
+
+        return m_blocks[m_readIndex];
+    }
+
+    void release()
+    {
+        m_readIndex = (m_readIndex + 1) % READ_AHEAD_BLOCK_COUNT;
+        m_freeBlocks.release();
+    }
+
+private:
+    void run()
+    {
+        Q_FOREVER {
+            m_freeBlocks.acquire();
+
+            if (m_stop.load()) {
+                break;
+            }
+
+            Block &block = m_blocks[m_writeIndex];
+
+            block.pos = m_device->pos();
+            block.size = m_device->read(block.data.data(), block.data.size());
+            block.atEnd = block.size <= 0 && m_device->atEnd();
+
+            if (block.size > 0 && m_checksum) {
+                block.checksum = adler32(adler32(0L, nullptr, 0), reinterpret_cast<const Bytef *>(block.data.constData()), block.size);
+            }
+
+            // 发布数据块后不能再访问它
+            const bool finished = block.size <= 0;
+
+            m_writeIndex = (m_writeIndex + 1) % READ_AHEAD_BLOCK_COUNT;
+            m_usedBlocks.release();
+
+            if (finished) {
+                break;
+            }
+        }
+    }
+
+    QIODevice *m_device;
+    bool m_checksum;
+    QThreadPool *m_pool;
+    Block m_blocks[READ_AHEAD_BLOCK_COUNT];
+    QSemaphore m_freeBlocks;
+    QSemaphore m_usedBlocks;
+    int m_readIndex = 0;
+    int m_writeIndex = 0;
+    QAtomicInt m_stop;
+    QFuture<void> m_future;
+};
+
 DFileCopyMoveJobPrivate::DFileCopyMoveJobPrivate(DFileCopyMoveJob *qq)
     : q_ptr(qq)
     , updateSpeedElapsedTimer(new ElapsedTimer())
 {
-
+    smallFileCopyPool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+    readAheadPool.setMaxThreadCount(1);
 }
 
 DFileCopyMoveJobPrivate::~DFileCopyMoveJobPrivate()
 {
+    if (targetStatFd >= 0) {
+        close(targetStatFd);
+    }
+
     delete updateSpeedElapsedTimer;
 }
 
@@ -198,69 +453,46 @@ QString DFileCopyMoveJobPrivate::errorToString(DFileCopyMoveJob::Error error)
     return QString();
 }
 
-qint64 DFileCopyMoveJobPrivate::getWriteBytes(long tid)
+qint64 DFileCopyMoveJobPrivate::getSectorsWritten() const
 {
-    QFile file(QStringLiteral("/proc/self/task/%1/io").arg(tid));
-
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed on open the" << file.fileName() << ", will be not update the job speed and progress";
+    char buffer[256];
+    ssize_t size = pread(targetStatFd, buffer, sizeof(buffer) - 1, 0);
 
+    if (size <= 0) {
         return 0;
     }
 
-    const QByteArray &line_head = QByteArrayLiteral("write_bytes: ");
-    const QByteArray &all_data = file.readAll();
-
-    file.close();
+    buffer[size] = '\0';
 
-    QTextStream text_stream(all_data);
+    const char *field = buffer;
+    char *end = nullptr;
+    qint64 value = 0;
 
-    while (!text_stream.atEnd()) {
-        const QByteArray &line = text_stream.readLine().toLatin1();
+    for (int i = 0; i < 7; ++i) {
+        value = strtoll(field, &end, 10);
 
-        if (line.startsWith(line_head)) {
-            bool ok = false;
-            qint64 size = line.mid(line_head.size()).toLongLong(&ok);
-
-            if (!ok) {
-                qWarning() << "Failed to convert to qint64, line string=" << line;
-
-                return 0;
-            }
-
-            qCDebug(fileJob(), "Did Write size on block device: %lld", size);
-
-            return size;
+        if (end == field) {
+            return 0;
         }
-    }
-
-    qWarning() << "Failed to find \"" << line_head << "\" from the" << file.fileName();
-
-    return 0;
-}
-
-qint64 DFileCopyMoveJobPrivate::getWriteBytes() const
-{
-    return getWriteBytes(tid);
-}
 
-qint64 DFileCopyMoveJobPrivate::getSectorsWritten() const
-{
-    const QByteArray data = fileReadAll(targetSysDevPath + "/stat");
+        field = end;
+    }
 
-    return data.simplified().split(' ').value(6).toLongLong();
+    return value;
 }
 
 qint64 DFileCopyMoveJobPrivate::getCompletedDataSize() const
 {
-    if (canUseWriteBytes) {
-        return getWriteBytes();
-    }
+    QMutexLocker locker(&targetStatFdLock);
 
-    if (targetDeviceStartSectorsWritten >= 0) {
-        return (getSectorsWritten() - targetDeviceStartSectorsWritten) * targetLogSecionSize;
+    // 可移除设备的写入速度远低于页缓存，以实际写入设备的数据量为准
+    // stat 文件中的扇区数总是以 512 字节为单位，与设备的逻辑扇区大小无关
+    if (targetStatFd >= 0) {
+        return (getSectorsWritten() - targetDeviceStartSectorsWritten) * 512;
     }
 
+    locker.unlock();
+
     return completedDataSize;
 }
 
@@ -322,6 +554,20 @@ void DFileCopyMoveJobPrivate::unsetError()
 DFileCopyMoveJob::Action DFileCopyMoveJobPrivate::handleError(const DAbstractFileInfo *sourceInfo,
         const DAbstractFileInfo *targetInfo)
 {
+    // 先处理之前提交的并行复制，使它们的错误在此错误之前报告
+    if (!smallFileCopyQueue.isEmpty() && !completingSmallFileCopies) {
+        const DFileCopyMoveJob::Error current_error = error;
+        const QString current_error_string = errorString;
+
+        if (!completeSmallFileCopies(0)) {
+            lastErrorHandleAction = DFileCopyMoveJob::CancelAction;
+
+            return lastErrorHandleAction;
+        }
+
+        setError(current_error, current_error_string);
+    }
+
     if (actionOfError[error] != DFileCopyMoveJob::NoAction) {
         lastErrorHandleAction = actionOfError[error];
         unsetError();
@@ -397,11 +643,11 @@ DFileCopyMoveJob::Action DFileCopyMoveJobPrivate::handleError(const DAbstractFil
 
 bool DFileCopyMoveJobPrivate::jobWait()
 {
-    QMutex lock;
+    QMutexLocker locker(&waitMutex);
 
-    lock.lock();
-    waitCondition.wait(&lock);
-    lock.unlock();
+    while (state == DFileCopyMoveJob::PausedState) {
+        waitCondition.wait(&waitMutex);
+    }
 
     return state == DFileCopyMoveJob::RunningState;
 }
@@ -676,6 +922,10 @@ create_new_file_info:
                 }
             }
 
+            if (!completeSmallFileCopies(0)) {
+                return false;
+            }
+
             ok = linkFile(handler, new_file_info.constData(), source_info->symlinkTargetPath());
         } else {
             ok = renameFile(handler, source_info.constData(), new_file_info.constData());
@@ -726,6 +976,18 @@ process_file:
         }
 
         if (mode == DFileCopyMoveJob::CopyMode) {
+            if (canCopyInParallel(source_info.constData(), new_file_info.constData(), size)) {
+                // 复制完成后再加入到已完成的文件列表中
+                copySmallFileInParallel(from, source_info, target_info, new_file_info, size);
+
+                return true;
+            }
+
+            // 此文件在任务线程中复制，先完成排在它之前的并行复制，保证已完成的文件列表按遍历的顺序排列
+            if (!completeSmallFileCopies(0)) {
+                return false;
+            }
+
             if (new_file_info->isSymLink() || fileHints.testFlag(DFileCopyMoveJob::RemoveDestination)) {
                 if (!removeFile(handler, new_file_info.constData())) {
                     return false;
@@ -832,6 +1094,9 @@ bool DFileCopyMoveJobPrivate::mergeDirectory(DFileHandler *handler, const DAbstr
         enterDirectory(fromInfo->fileUrl(), toInfo->fileUrl());
     }
 
+    const bool old_defer_small_file_copy = deferSmallFileCopy;
+    deferSmallFileCopy = true;
+
     while (iterator->hasNext()) {
         if (!stateCheck()) {
             return false;
@@ -847,6 +1112,17 @@ bool DFileCopyMoveJobPrivate::mergeDirectory(DFileHandler *handler, const DAbstr
         if (lastErrorHandleAction == DFileCopyMoveJob::SkipAction) {
             existsSkipFile = true;
         }
+
+        if (!completeSmallFileCopies(smallFileCopyPool.maxThreadCount() * 4)) {
+            return false;
+        }
+    }
+
+    deferSmallFileCopy = old_defer_small_file_copy;
+
+    // 修改目录的权限前，确保其中的文件都已复制完成
+    if (!completeSmallFileCopies(0)) {
+        return false;
     }
 
     if (enter_dir) {
@@ -968,22 +1244,106 @@ open_file: {
 
 //    int writtenDataSize = 0;
     uLong source_checksum = adler32(0L, nullptr, 0);
+    bool reflinked = false;
+    QScopedPointer<BlockReader> reader;
+
+    if (copyBuffer.size() < blockSize) {
+        copyBuffer.resize(blockSize);
+    }
+
+#ifdef Q_OS_LINUX
+    if (canUseKernelCopy()) {
+        switch (kernelCopyFile(fromInfo, toInfo, fromDevice->handle(), toDevice->handle(), blockSize, &reflinked)) {
+        case KernelCopyUnsupported:
+            break;
+        case KernelCopyFinished: {
+            if (reflinked || fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)) {
+                goto close_file;
+            }
+
+            // 数据由内核直接复制，只能再读一次源文件（通常已在页缓存中）来计算完整性校验所需的校验值
+            char *data = copyBuffer.data();
+
+            Q_FOREVER {
+                if (Q_UNLIKELY(!stateCheck())) {
+                    return false;
+                }
+
+                qint64 size = fromDevice->read(data, blockSize);
+
+                if (Q_UNLIKELY(size <= 0)) {
+                    if (fromDevice->atEnd()) {
+                        break;
+                    }
+
+                    setError(DFileCopyMoveJob::ReadError, qApp->translate("DFileCopyMoveJob", "Failed to read the file, cause: %1").arg(fromDevice->errorString()));
+
+                    switch (handleError(fromInfo, toInfo)) {
+                    case DFileCopyMoveJob::RetryAction:
+                        continue;
+                    case DFileCopyMoveJob::SkipAction:
+                        return true;
+                    default:
+                        return false;
+                    }
+                }
+
+                source_checksum = adler32(source_checksum, reinterpret_cast<Bytef *>(data), size);
+            }
+
+            goto close_file;
+        }
+        case KernelCopySkipped:
+            return true;
+        case KernelCopyFailed:
+            return false;
+        }
+    }
+#endif
+
+    // 大文件的读取和写入同时进行，读取线程提前读出后面的数据块并计算其校验值
+    if (currentJobDataSizeInfo.first > blockSize) {
+        reader.reset(new BlockReader(fromDevice.data(), blockSize,
+                                     !fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking),
+                                     &readAheadPool));
+        reader->start();
+    }
 
     Q_FOREVER {
-        qint64 current_pos = fromDevice->pos();
+        qint64 current_pos = reader ? 0 : fromDevice->pos();
     read_data:
         if (Q_UNLIKELY(!stateCheck())) {
             return false;
         }
 
-        char data[blockSize + 1];
-        qint64 size_read = fromDevice->read(data, blockSize);
+        const char *data = copyBuffer.constData();
+        qint64 size_read = 0;
+        uLong block_checksum = 0;
+        bool at_end = false;
+
+        if (reader) {
+            const BlockReader::Block &block = reader->take();
+
+            data = block.data.constData();
+            size_read = block.size;
+            block_checksum = block.checksum;
+            at_end = block.atEnd;
+            current_pos = block.pos;
+        } else {
+            size_read = fromDevice->read(copyBuffer.data(), blockSize);
+            at_end = size_read <= 0 && fromDevice->atEnd();
+        }
 
         if (Q_UNLIKELY(size_read <= 0)) {
-            if (fromDevice->atEnd()) {
+            if (at_end) {
                 break;
             }
 
+            // 读取线程在出错后已经退出，等待其结束后再由当前线程处理错误
+            if (reader) {
+                reader->stop();
+            }
+
             const_cast<DAbstractFileInfo *>(fromInfo)->refresh();
 
             if (fromInfo->exists()) {
@@ -1000,6 +1360,10 @@ open_file: {
                     return false;
                 }
 
+                if (reader) {
+                    reader->start();
+                }
+
                 goto read_data;
             }
             case DFileCopyMoveJob::SkipAction:
@@ -1070,8 +1434,14 @@ open_file: {
         completedDataSize += size_write;
 //        writtenDataSize += size_write;
 
-        if (Q_LIKELY(!fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking))) {
-            source_checksum = adler32(source_checksum, reinterpret_cast<Bytef *>(data), size_read);
+        if (reader) {
+            if (Q_LIKELY(!fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking))) {
+                source_checksum = adler32_combine(source_checksum, block_checksum, size_read);
+            }
+
+            reader->release();
+        } else if (Q_LIKELY(!fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking))) {
+            source_checksum = adler32(source_checksum, reinterpret_cast<const Bytef *>(data), size_read);
         }
 
 //        if (Q_UNLIKELY(writtenDataSize > 20000000)) {
@@ -1080,6 +1450,16 @@ open_file: {
 //        }
     }
 
+    reader.reset();
+
+#ifdef Q_OS_LINUX
+    // 大文件复制完成后源文件的数据不会再被使用，避免其占满页缓存把其它数据挤出去
+    if (currentJobDataSizeInfo.first > blockSize && fromDevice->handle() > 0) {
+        posix_fadvise(fromDevice->handle(), 0, 0, POSIX_FADV_DONTNEED);
+    }
+#endif
+
+close_file:
     // 关闭文件时可能会需要很长时间，因为内核可能要把内存里的脏数据回写到硬盘
     setState(DFileCopyMoveJob::IOWaitState);
     fromDevice->close();
@@ -1091,7 +1471,8 @@ open_file: {
         return false;
     }
 
-    if (fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)) {
+    // 通过 reflink 复制的文件与源文件共享数据块，无需校验
+    if (reflinked || fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)) {
         return true;
     }
 
@@ -1110,7 +1491,7 @@ open_file: {
         return true;
     }
 
-    char data[blockSize + 1];
+    char *data = copyBuffer.data();
     ulong target_checksum = adler32(0L, nullptr, 0);
 
     qint64 elapsed_time_checksum = 0;
@@ -1149,6 +1530,12 @@ open_file: {
 
     qCDebug(fileJob(), "Time spent of integrity check of the file: %lld", updateSpeedElapsedTimer->elapsed() - elapsed_time_checksum);
 
+#ifdef Q_OS_LINUX
+    if (currentJobDataSizeInfo.first > blockSize && toDevice->handle() > 0) {
+        posix_fadvise(toDevice->handle(), 0, 0, POSIX_FADV_DONTNEED);
+    }
+#endif
+
     if (source_checksum != target_checksum) {
         qCWarning(fileJob(), "Failed on file integrity checking, source file: 0x%lx, target file: 0x%lx", source_checksum, target_checksum);
 
@@ -1171,6 +1558,127 @@ open_file: {
     return true;
 }
 
+#ifdef Q_OS_LINUX
+bool DFileCopyMoveJobPrivate::canUseKernelCopy() const
+{
+    if (directoryStack.isEmpty()) {
+        return false;
+    }
+
+    const DStorageInfo &storage_source = directoryStack.top().sourceStorageInfo;
+    const DStorageInfo &storage_target = directoryStack.top().targetStorageInfo;
+
+    // 只在本地设备之间使用，gvfs 等 fuse 挂载的目录中的文件仍使用普通的读写方式复制
+    return storage_source.isValid() && storage_target.isValid()
+            && storage_source.isLocalDevice() && storage_target.isLocalDevice();
+}
+
+DFileCopyMoveJobPrivate::KernelCopyResult
+DFileCopyMoveJobPrivate::kernelCopyFile(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo,
+                                        int fromFd, int toFd, int blockSize, bool *reflinked)
+{
+    if (fromFd < 0 || toFd < 0) {
+        return KernelCopyUnsupported;
+    }
+
+#ifdef FICLONE
+    // 在同一个支持 reflink 的文件系统（btrfs、xfs等）中，让目标文件直接共享源文件的数据块
+    if (directoryStack.top().sourceStorageInfo == directoryStack.top().targetStorageInfo
+            && ioctl(toFd, FICLONE, fromFd) == 0) {
+        const qint64 size = qMax(currentJobDataSizeInfo.first, qint64(0));
+
+        currentJobDataSizeInfo.second += size;
+        completedDataSize += size;
+        *reflinked = true;
+
+        return KernelCopyFinished;
+    }
+#endif
+
+#ifdef SYS_copy_file_range
+    bool use_sendfile = false;
+#else
+    bool use_sendfile = true;
+#endif
+    qint64 offset = 0;
+
+    Q_FOREVER {
+        if (Q_UNLIKELY(!stateCheck())) {
+            return KernelCopyFailed;
+        }
+
+        ssize_t size_copied = -1;
+
+        if (!use_sendfile) {
+#ifdef SYS_copy_file_range
+            loff_t from_offset = offset;
+            loff_t to_offset = offset;
+
+            size_copied = syscall(SYS_copy_file_range, fromFd, &from_offset, toFd, &to_offset, size_t(blockSize), 0u);
+
+            // 内核或文件系统不支持时，改用 sendfile
+            if (size_copied < 0 && offset == 0
+                    && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                use_sendfile = true;
+
+                continue;
+            }
+#endif
+        } else {
+            off_t from_offset = offset;
+
+            size_copied = sendfile(toFd, fromFd, &from_offset, size_t(blockSize));
+
+            if (size_copied < 0 && offset == 0 && (errno == ENOSYS || errno == EINVAL)) {
+                return KernelCopyUnsupported;
+            }
+        }
+
+        if (size_copied == 0) {
+            break;
+        }
+
+        if (Q_LIKELY(size_copied > 0)) {
+            offset += size_copied;
+            currentJobDataSizeInfo.second += size_copied;
+            completedDataSize += size_copied;
+
+            continue;
+        }
+
+        const int error_number = errno;
+
+        if (error_number == EINTR || error_number == EAGAIN) {
+            continue;
+        }
+
+        if (error_number == ENOSPC || !checkFreeSpace(currentJobDataSizeInfo.first - currentJobDataSizeInfo.second)) {
+            setError(DFileCopyMoveJob::NotEnoughSpaceError);
+        } else {
+            setError(DFileCopyMoveJob::WriteError, qApp->translate("DFileCopyMoveJob", "Failed to write the file, cause: %1").arg(QString::fromLocal8Bit(strerror(error_number))));
+        }
+
+        switch (handleError(fromInfo, toInfo)) {
+        case DFileCopyMoveJob::RetryAction:
+            // sendfile 会移动目标文件的读写位置，重试前将其恢复到已复制数据的末尾
+            if (use_sendfile && lseek(toFd, offset, SEEK_SET) < 0) {
+                setError(DFileCopyMoveJob::UnknowError, QString::fromLocal8Bit(strerror(errno)));
+
+                return KernelCopyFailed;
+            }
+
+            continue;
+        case DFileCopyMoveJob::SkipAction:
+            return KernelCopySkipped;
+        default:
+            return KernelCopyFailed;
+        }
+    }
+
+    return KernelCopyFinished;
+}
+#endif
+
 bool DFileCopyMoveJobPrivate::doRemoveFile(DFileHandler *handler, const DAbstractFileInfo *fileInfo)
 {
     if (!fileInfo->exists()) {
@@ -1253,6 +1761,107 @@ bool DFileCopyMoveJobPrivate::doLinkFile(DFileHandler *handler, const DAbstractF
     return action == DFileCopyMoveJob::SkipAction;
 }
 
+bool DFileCopyMoveJobPrivate::canCopyInParallel(const DAbstractFileInfo *sourceInfo, const DAbstractFileInfo *targetInfo, qint64 size) const
+{
+    if (!deferSmallFileCopy || mode != DFileCopyMoveJob::CopyMode || size > SMALL_FILE_SIZE) {
+        return false;
+    }
+
+    if (directoryStack.isEmpty() || targetIsRemovable) {
+        return false;
+    }
+
+    if (!sourceInfo->fileUrl().isLocalFile() || !targetInfo->fileUrl().isLocalFile() || targetInfo->exists()) {
+        return false;
+    }
+
+    const DStorageInfo &storage_source = directoryStack.top().sourceStorageInfo;
+    const DStorageInfo &storage_target = directoryStack.top().targetStorageInfo;
+
+    // 低速设备上并行读写只会增加寻道的开销
+    return storage_source.isValid() && storage_target.isValid()
+            && storage_source.isLocalDevice() && storage_target.isLocalDevice()
+            && !storage_source.isLowSpeedDevice() && !storage_target.isLowSpeedDevice();
+}
+
+void DFileCopyMoveJobPrivate::copySmallFileInParallel(const DUrl &from, const DAbstractFileInfoPointer &sourceInfo,
+                                                      const DAbstractFileInfo *targetDirectoryInfo,
+                                                      const DAbstractFileInfoPointer &targetInfo, qint64 size)
+{
+    const QByteArray &from_path = QFile::encodeName(sourceInfo->fileUrl().toLocalFile());
+    const QByteArray &to_path = QFile::encodeName(targetInfo->fileUrl().toLocalFile());
+    bool integrity_checking = !fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking);
+
+    SmallFileCopyTask task;
+
+    task.from = from;
+    task.sourceInfo = sourceInfo;
+    task.targetInfo = targetInfo;
+    task.targetDirectoryInfo = DAbstractFileInfoPointer(const_cast<DAbstractFileInfo *>(targetDirectoryInfo));
+    task.directory = directoryStack.top();
+    task.size = size;
+    task.result = QtConcurrent::run(&smallFileCopyPool, [this, from_path, to_path, integrity_checking] {
+        // 任务暂停时等待，停止后不再复制，未复制的文件不会加入到已完成的文件列表中
+        if (state == DFileCopyMoveJob::PausedState) {
+            jobWait();
+        }
+
+        if (state == DFileCopyMoveJob::StoppedState) {
+            return false;
+        }
+
+        return copyLocalSmallFile(from_path, to_path, integrity_checking);
+    });
+
+    smallFileCopyQueue.enqueue(task);
+}
+
+bool DFileCopyMoveJobPrivate::completeSmallFileCopies(int keepCount, bool retryFailed)
+{
+    // 重新处理失败的文件时会再次调用到这里，剩下的任务由外层按顺序处理
+    if (completingSmallFileCopies) {
+        return true;
+    }
+
+    bool ok = true;
+    const DFileCopyMoveJob::Action last_action = lastErrorHandleAction;
+
+    completingSmallFileCopies = true;
+
+    while (!smallFileCopyQueue.isEmpty()) {
+        if (smallFileCopyQueue.count() <= keepCount && !smallFileCopyQueue.head().result.isFinished()) {
+            break;
+        }
+
+        const SmallFileCopyTask task = smallFileCopyQueue.dequeue();
+
+        if (task.result.result()) {
+            beginJob(JobInfo::Copy, task.from, task.targetInfo->fileUrl());
+            lastErrorHandleAction = DFileCopyMoveJob::NoAction;
+            joinToCompletedFileList(task.from, task.targetInfo->fileUrl(), task.size);
+            endJob();
+        } else if (retryFailed && ok && state != DFileCopyMoveJob::StoppedState) {
+            // 并行复制失败时在提交它时所在的目录下按普通的流程重新处理此文件，
+            // 目标文件在此期间被创建时同样会询问用户，由其负责报告错误和加入到已完成的文件列表中
+            const bool old_defer_small_file_copy = deferSmallFileCopy;
+
+            deferSmallFileCopy = false;
+            directoryStack.push(task.directory);
+            ok = process(task.from, task.sourceInfo, task.targetDirectoryInfo.constData());
+            directoryStack.pop();
+            deferSmallFileCopy = old_defer_small_file_copy;
+        }
+    }
+
+    completingSmallFileCopies = false;
+
+    if (ok) {
+        lastErrorHandleAction = last_action;
+    }
+
+    return ok;
+}
+
 bool DFileCopyMoveJobPrivate::process(const DUrl &from, const DAbstractFileInfo *target_info)
 {
     const DAbstractFileInfoPointer &source_info = DFileService::instance()->createFileInfo(nullptr, from);
@@ -1639,6 +2248,8 @@ void DFileCopyMoveJob::stop()
     d->fileStatistics->stop();
 
     d->setState(StoppedState);
+
+    QMutexLocker locker(&d->waitMutex);
     d->waitCondition.wakeAll();
 }
 
@@ -1654,6 +2265,8 @@ void DFileCopyMoveJob::togglePause()
 
     if (d->state == PausedState) {
         d->setState(RunningState);
+
+        QMutexLocker locker(&d->waitMutex);
         d->waitCondition.wakeAll();
     } else {
         d->setState(PausedState);
@@ -1708,7 +2321,7 @@ void DFileCopyMoveJob::run()
     d->completedDataSize = 0;
     d->completedDataSizeOnBlockDevice = 0;
     d->completedFilesCount = 0;
-    d->tid = qt_gettid();
+    d->deferSmallFileCopy = false;
 
     DAbstractFileInfoPointer target_info;
 
@@ -1731,11 +2344,8 @@ void DFileCopyMoveJob::run()
         }
 
         // reset
-        d->canUseWriteBytes = 0;
-        d->targetIsRemovable = 0;
-        d->targetLogSecionSize = 512;
+        d->targetIsRemovable = false;
         d->targetDeviceStartSectorsWritten = -1;
-        d->targetSysDevPath.clear();
         d->targetRootPath.clear();
 
         QScopedPointer<DStorageInfo> targetStorageInfo(DFileService::instance()->createStorageInfo(nullptr, d->targetUrl));
@@ -1746,52 +2356,23 @@ void DFileCopyMoveJob::run()
             qCDebug(fileJob(), "Target block device: \"%s\", Root Path: \"%s\"",
                     targetStorageInfo->device().constData(), qPrintable(d->targetRootPath));
 
-            if (targetStorageInfo->isLocalDevice()) {
-                d->canUseWriteBytes = targetStorageInfo->fileSystemType().startsWith("ext");
-
-                if (!d->canUseWriteBytes) {
-                    const QByteArray dev_path = targetStorageInfo->device();
-
-                    QProcess process;
-
-                    process.start("lsblk", {"-niro", "MAJ:MIN,HOTPLUG,LOG-SEC", dev_path}, QIODevice::ReadOnly);
+            BlockDeviceInfo device_info;
 
-                    if (process.waitForFinished(3000)) {
-                        if (process.exitCode() == 0) {
-                            const QByteArray &data = process.readAllStandardOutput();
-                            const QByteArrayList &list = data.split(' ');
+            if (targetStorageInfo->isLocalDevice() && blockDeviceInfo(targetStorageInfo->device(), &device_info)) {
+                d->targetIsRemovable = device_info.removable;
 
-                            qCDebug(fileJob(), "lsblk result data: \"%s\"", data.constData());
+                if (d->targetIsRemovable) {
+                    QMutexLocker locker(&d->targetStatFdLock);
 
-                            if (list.size() == 3) {
-                                d->targetSysDevPath = "/sys/dev/block/" + list.first();
-                                d->targetIsRemovable = list.at(1) == "1";
+                    d->targetStatFd = open((device_info.sysDevPath + "/stat").constData(), O_RDONLY | O_CLOEXEC);
 
-                                bool ok = false;
-                                d->targetLogSecionSize = list.at(2).toInt(&ok);
-
-                                if (!ok) {
-                                    d->targetLogSecionSize = 512;
-
-                                    qCWarning(fileJob(), );
-                                }
-
-                                if (d->targetIsRemovable) {
-                                    d->targetDeviceStartSectorsWritten = d->getSectorsWritten();
-                                }
-
-                                qCDebug(fileJob(), "Block device path: \"%s\", Sys dev path: \"%s\", Is removable: %d, Log-Sec: %d",
-                                        qPrintable(dev_path), qPrintable(d->targetSysDevPath), bool(d->targetIsRemovable), d->targetLogSecionSize);
-                            } else {
-                                qCWarning(fileJob(), "Failed on parse the lsblk result data, data: \"%s\"", data.constData());
-                            }
-                        } else {
-                            qCWarning(fileJob(), "Failed on exec lsblk command, exit code: %d, error message: \"%s\"", process.exitCode(), process.readAllStandardError().constData());
-                        }
+                    if (d->targetStatFd >= 0) {
+                        d->targetDeviceStartSectorsWritten = d->getSectorsWritten();
                     }
                 }
 
-                qCDebug(fileJob(), "canUseWriteBytes = %d, targetIsRemovable = %d", bool(d->canUseWriteBytes));
+                qCDebug(fileJob(), "Sys dev path: \"%s\", Is removable: %d",
+                        device_info.sysDevPath.constData(), d->targetIsRemovable);
             }
         }
     } else if (d->mode == CopyMode) {
@@ -1849,16 +2430,33 @@ void DFileCopyMoveJob::run()
     d->setError(NoError);
 
 end:
+    // 任务中止时，仍将已经并行复制完成的文件加入到已完成的文件列表中
+    d->completeSmallFileCopies(0, false);
+
     if (d->targetIsRemovable) {
         // 任务完成后执行 sync 同步数据到硬盘, 同时将状态改为 SleepState，用于定时器更新进度和速度信息
         d->setState(IOWaitState);
-        QProcess::execute("sync", {"-f", d->targetRootPath});
+        int root_fd = open(d->targetRootPath.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+
+        if (root_fd >= 0) {
+            syncfs(root_fd);
+            close(root_fd);
+        }
         // 恢复状态
         if (d->state == IOWaitState) {
             d->setState(RunningState);
         }
     }
 
+    d->targetStatFdLock.lock();
+
+    if (d->targetStatFd >= 0) {
+        close(d->targetStatFd);
+        d->targetStatFd = -1;
+    }
+
+    d->targetStatFdLock.unlock();
+
     d->fileStatistics->stop();
     d->setState(StoppedState);
 
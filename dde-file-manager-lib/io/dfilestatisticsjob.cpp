@@ -27,6 +27,16 @@
 #include <QQueue>
 #include <QTimer>
 #include <QWaitCondition>
+#include <QSet>
+#include <QMetaMethod>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <mntent.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 DFM_BEGIN_NAMESPACE
 
@@ -42,6 +52,13 @@ public:
 
     void processFile(const DUrl &url, QQueue<DUrl> &directoryQueue);
 
+    // 本地目录由多个线程并行统计，直接通过系统调用读取目录项，不为每个文件创建 DAbstractFileInfo
+    void loadSkipMountPoints();
+    bool markInodeVisited(const struct stat &st);
+    void walkLocalDirectories(const QByteArrayList &directories);
+    void localDirectoryWorker();
+    void processLocalDirectory(const QByteArray &path, QByteArrayList &directoryStack);
+
     DFileStatisticsJob *q_ptr;
     QTimer *notifyDataTimer;
 
@@ -49,17 +66,36 @@ public:
     DFileStatisticsJob::FileHints fileHints;
 
     DUrlList sourceUrlList;
+    // 暂停时所有统计线程都在此等待，唤醒前需要先锁住 waitMutex，防止唤醒发生在检查状态和开始等待之间
+    QMutex waitMutex;
     QWaitCondition waitCondition;
 
     QAtomicInteger<qint64> totalSize = 0;
     QAtomicInt filesCount = 0;
     QAtomicInt directoryCount = 0;
+
+    // 各线程共享的待统计目录，线程自己的目录栈不为空时不会访问此队列
+    QMutex walkerMutex;
+    QWaitCondition walkerCondition;
+    QByteArrayList walkerQueue;
+    int walkerCount = 0;
+    QAtomicInt walkerIdleCount = 0;
+    QThreadPool walkerPool;
+
+    QMutex inodeMutex;
+    QSet<QPair<quint64, quint64>> visitedInodes;
+    // 需要跳过的 proc 和 avfsd 挂载点，任务开始时从挂载表中读取一次
+    QSet<QByteArray> skipMountPoints;
+
+    bool emitFileFound = false;
+    bool emitDirectoryFound = false;
+    bool emitSizeChanged = false;
 };
 
 DFileStatisticsJobPrivate::DFileStatisticsJobPrivate(DFileStatisticsJob *qq)
     : q_ptr(qq)
 {
-
+    walkerPool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
 }
 
 void DFileStatisticsJobPrivate::setState(DFileStatisticsJob::State s)
@@ -89,11 +125,11 @@ void DFileStatisticsJobPrivate::setState(DFileStatisticsJob::State s)
 
 bool DFileStatisticsJobPrivate::jobWait()
 {
-    QMutex lock;
+    QMutexLocker locker(&waitMutex);
 
-    lock.lock();
-    waitCondition.wait(&lock);
-    lock.unlock();
+    while (state == DFileStatisticsJob::PausedState) {
+        waitCondition.wait(&waitMutex);
+    }
 
     return state == DFileStatisticsJob::RunningState;
 }
@@ -209,6 +245,230 @@ void DFileStatisticsJobPrivate::processFile(const DUrl &url, QQueue<DUrl> &direc
     }
 }
 
+void DFileStatisticsJobPrivate::loadSkipMountPoints()
+{
+    skipMountPoints.clear();
+
+    FILE *mount_table = setmntent("/proc/self/mounts", "r");
+
+    if (!mount_table) {
+        return;
+    }
+
+    while (const struct mntent *entry = getmntent(mount_table)) {
+        const QByteArray device(entry->mnt_fsname);
+
+        if ((!fileHints.testFlag(DFileStatisticsJob::DontSkipPROCStorage) && device == "proc")
+                || (!fileHints.testFlag(DFileStatisticsJob::DontSkipAVFSDStorage) && device == "avfsd")) {
+            skipMountPoints << QByteArray(entry->mnt_dir);
+        }
+    }
+
+    endmntent(mount_table);
+}
+
+bool DFileStatisticsJobPrivate::markInodeVisited(const struct stat &st)
+{
+    QMutexLocker locker(&inodeMutex);
+    const QPair<quint64, quint64> inode(st.st_dev, st.st_ino);
+
+    if (visitedInodes.contains(inode)) {
+        return false;
+    }
+
+    visitedInodes.insert(inode);
+
+    return true;
+}
+
+void DFileStatisticsJobPrivate::walkLocalDirectories(const QByteArrayList &directories)
+{
+    walkerQueue = directories;
+    walkerCount = walkerPool.maxThreadCount() + 1;
+    walkerIdleCount = 0;
+
+    QList<QFuture<void>> workers;
+
+    for (int i = 1; i < walkerCount; ++i) {
+        workers << QtConcurrent::run(&walkerPool, [this] {
+            localDirectoryWorker();
+        });
+    }
+
+    // 当前线程也参与统计
+    localDirectoryWorker();
+
+    for (QFuture<void> &worker : workers) {
+        worker.waitForFinished();
+    }
+
+    walkerQueue.clear();
+}
+
+void DFileStatisticsJobPrivate::localDirectoryWorker()
+{
+    QByteArrayList directory_stack;
+
+    Q_FOREVER {
+        if (directory_stack.isEmpty()) {
+            QMutexLocker locker(&walkerMutex);
+
+            walkerIdleCount.ref();
+
+            // 所有线程都空闲且队列为空时统计结束
+            while (walkerQueue.isEmpty() && walkerIdleCount.load() < walkerCount
+                   && state != DFileStatisticsJob::StoppedState) {
+                walkerCondition.wait(&walkerMutex, 100);
+            }
+
+            if (walkerQueue.isEmpty() || state == DFileStatisticsJob::StoppedState) {
+                walkerCondition.wakeAll();
+
+                return;
+            }
+
+            walkerIdleCount.deref();
+            directory_stack << walkerQueue.takeLast();
+        }
+
+        if (!stateCheck()) {
+            return;
+        }
+
+        processLocalDirectory(directory_stack.takeLast(), directory_stack);
+
+        // 有空闲的线程时分出一半目录给它们
+        if (directory_stack.size() > 1 && walkerIdleCount.load() > 0) {
+            QMutexLocker locker(&walkerMutex);
+            const int count = directory_stack.size() / 2;
+
+            walkerQueue << directory_stack.mid(0, count);
+            directory_stack.erase(directory_stack.begin(), directory_stack.begin() + count);
+            walkerCondition.wakeAll();
+        }
+    }
+}
+
+void DFileStatisticsJobPrivate::processLocalDirectory(const QByteArray &path, QByteArrayList &directoryStack)
+{
+    int dir_fd = open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dir_fd < 0) {
+        return;
+    }
+
+    DIR *dir = fdopendir(dir_fd);
+
+    if (!dir) {
+        close(dir_fd);
+        return;
+    }
+
+    const bool follow_symlink = fileHints.testFlag(DFileStatisticsJob::FollowSymlink);
+    const QByteArray prefix = path.endsWith('/') ? path : path + '/';
+    qint64 directory_size = 0;
+
+    while (const struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.' && (entry->d_name[1] == '\0' || (entry->d_name[1] == '.' && entry->d_name[2] == '\0'))) {
+            continue;
+        }
+
+        if (!stateCheck()) {
+            break;
+        }
+
+        const QByteArray file_path = prefix + entry->d_name;
+        unsigned char type = entry->d_type;
+        struct stat st;
+        bool has_stat = false;
+
+        // 目录项中已有类型时，目录（不跟随链接时）和其它特殊文件都无需再读取其属性
+        if (type == DT_UNKNOWN || type == DT_REG || (follow_symlink && (type == DT_LNK || type == DT_DIR))) {
+            has_stat = fstatat(dir_fd, entry->d_name, &st, follow_symlink ? 0 : AT_SYMLINK_NOFOLLOW) == 0;
+
+            if (has_stat) {
+                type = IFTODT(st.st_mode);
+            } else if (type == DT_UNKNOWN || type == DT_LNK) {
+                // 无法访问的文件或无效的链接都当作普通文件统计
+                type = DT_REG;
+            }
+        }
+
+        if (type == DT_DIR) {
+            ++directoryCount;
+
+            if (emitDirectoryFound) {
+                Q_EMIT q_ptr->directoryFound(DUrl::fromLocalFile(QString::fromLocal8Bit(file_path)));
+            }
+
+            if (fileHints.testFlag(DFileStatisticsJob::SingleDepth) || skipMountPoints.contains(file_path)) {
+                continue;
+            }
+
+            // 跟随链接时同一个目录可能被访问多次，甚至形成循环
+            if (follow_symlink && has_stat && !markInodeVisited(st)) {
+                continue;
+            }
+
+            directoryStack << file_path;
+
+            continue;
+        }
+
+        ++filesCount;
+
+        if (emitFileFound) {
+            Q_EMIT q_ptr->fileFound(DUrl::fromLocalFile(QString::fromLocal8Bit(file_path)));
+        }
+
+        if (!has_stat) {
+            continue;
+        }
+
+        switch (type) {
+        case DT_CHR:
+            if (!fileHints.testFlag(DFileStatisticsJob::DontSkipCharDeviceFile))
+                continue;
+            break;
+        case DT_BLK:
+            if (!fileHints.testFlag(DFileStatisticsJob::DontSkipBlockDeviceFile))
+                continue;
+            break;
+        case DT_FIFO:
+            if (!fileHints.testFlag(DFileStatisticsJob::DontSkipFIFOFile))
+                continue;
+            break;
+        case DT_SOCK:
+            if (!fileHints.testFlag(DFileStatisticsJob::DontSkipSocketFile))
+                continue;
+            break;
+        default:
+            break;
+        }
+
+        // ###(zccrs): skip the file
+        if (file_path == "/proc/kcore") {
+            continue;
+        }
+
+        if (fileHints.testFlag(DFileStatisticsJob::SkipDuplicateHardLinks) && st.st_nlink > 1 && !markInodeVisited(st)) {
+            continue;
+        }
+
+        directory_size += st.st_size;
+    }
+
+    closedir(dir);
+
+    if (directory_size > 0) {
+        totalSize += directory_size;
+
+        if (emitSizeChanged) {
+            Q_EMIT q_ptr->sizeChanged(totalSize);
+        }
+    }
+}
+
 DFileStatisticsJob::DFileStatisticsJob(QObject *parent)
     : QThread(parent)
     , d_ptr(new DFileStatisticsJobPrivate(this))
@@ -279,6 +539,8 @@ void DFileStatisticsJob::stop()
     }
 
     d->setState(StoppedState);
+
+    QMutexLocker locker(&d->waitMutex);
     d->waitCondition.wakeAll();
 }
 
@@ -292,6 +554,8 @@ void DFileStatisticsJob::togglePause()
 
     if (d->state == PausedState) {
         d->setState(RunningState);
+
+        QMutexLocker locker(&d->waitMutex);
         d->waitCondition.wakeAll();
     } else {
         d->setState(PausedState);
@@ -317,7 +581,14 @@ void DFileStatisticsJob::run()
 
     Q_EMIT dataNotify(0, 0, 0);
 
+    d->emitFileFound = isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::fileFound));
+    d->emitDirectoryFound = isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::directoryFound));
+    d->emitSizeChanged = isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::sizeChanged));
+    d->visitedInodes.clear();
+    d->loadSkipMountPoints();
+
     QQueue<DUrl> directory_queue;
+    QByteArrayList local_directories;
 
     if (d->fileHints.testFlag(ExcludeSourceFile)) {
         for (const DUrl &url : d->sourceUrlList) {
@@ -368,6 +639,12 @@ void DFileStatisticsJob::run()
 
     while (!directory_queue.isEmpty()) {
         const DUrl &directory_url = directory_queue.dequeue();
+
+        if (directory_url.isLocalFile()) {
+            local_directories << directory_url.toLocalFile().toLocal8Bit();
+            continue;
+        }
+
         const DDirIteratorPointer &iterator = DFileService::instance()->createDirIterator(nullptr, directory_url, QStringList(),
                                               QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot, 0, true);
 
@@ -387,6 +664,10 @@ void DFileStatisticsJob::run()
         }
     }
 
+    if (!local_directories.isEmpty()) {
+        d->walkLocalDirectories(local_directories);
+    }
+
     d->setState(StoppedState);
 }
 
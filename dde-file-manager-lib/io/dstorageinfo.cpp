@@ -23,9 +23,268 @@
 #include "dstorageinfo.h"
 
 #include <QRegularExpression>
+#include <QThread>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+
+#include <memory>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 
 DFM_BEGIN_NAMESPACE
 
+namespace {
+
+struct MountEntry
+{
+    QString rootPath;
+    QByteArray device;
+    QByteArray fileSystemType;
+};
+
+// 挂载表快照，创建后不再修改，可被多个线程同时读取
+class MountTable
+{
+public:
+    explicit MountTable(const QByteArray &mountInfo);
+
+    const MountEntry *find(const QString &path) const;
+    const MountEntry *find(quint64 deviceId) const;
+
+private:
+    // 按挂载点长度降序排列，第一个匹配的挂载点即为最长前缀
+    QVector<MountEntry> entries;
+    QHash<quint64, int> deviceIdToIndex;
+};
+
+static QString unescapeMountInfo(const QByteArray &value)
+{
+    QByteArray result;
+
+    result.reserve(value.size());
+
+    for (int i = 0; i < value.size(); ++i) {
+        if (value.at(i) == '\\' && i + 3 < value.size()) {
+            bool ok = false;
+            const int ch = value.mid(i + 1, 3).toInt(&ok, 8);
+
+            if (ok) {
+                result.append(static_cast<char>(ch));
+                i += 3;
+                continue;
+            }
+        }
+
+        result.append(value.at(i));
+    }
+
+    return QFile::decodeName(result);
+}
+
+MountTable::MountTable(const QByteArray &mountInfo)
+{
+    // 同一挂载点被多次挂载时，只有最后挂载的可见
+    QMap<QString, QPair<MountEntry, quint64>> mount_points;
+
+    // 格式: id parent major:minor root mount-point options [optional...] - type source super-options
+    for (const QByteArray &line : mountInfo.split('\n')) {
+        const QList<QByteArray> &fields = line.split(' ');
+        const int separator = fields.indexOf("-");
+
+        if (separator < 6 || fields.size() < separator + 3)
+            continue;
+
+        const QList<QByteArray> &device_id = fields.at(2).split(':');
+
+        if (device_id.size() != 2)
+            continue;
+
+        MountEntry entry;
+
+        entry.rootPath = unescapeMountInfo(fields.at(4));
+        entry.fileSystemType = fields.at(separator + 1);
+        entry.device = unescapeMountInfo(fields.at(separator + 2)).toLocal8Bit();
+
+        mount_points[entry.rootPath] = qMakePair(entry, static_cast<quint64>(makedev(device_id.first().toUInt(), device_id.last().toUInt())));
+    }
+
+    QList<QPair<MountEntry, quint64>> list = mount_points.values();
+
+    std::stable_sort(list.begin(), list.end(), [] (const QPair<MountEntry, quint64> &first, const QPair<MountEntry, quint64> &second) {
+        return first.first.rootPath.size() > second.first.rootPath.size();
+    });
+
+    entries.reserve(list.size());
+
+    for (const QPair<MountEntry, quint64> &item : list) {
+        if (!deviceIdToIndex.contains(item.second))
+            deviceIdToIndex[item.second] = entries.size();
+
+        entries << item.first;
+    }
+}
+
+const MountEntry *MountTable::find(const QString &path) const
+{
+    for (const MountEntry &entry : entries) {
+        const QString &root = entry.rootPath;
+
+        if (root == QStringLiteral("/"))
+            return &entry;
+
+        if (path.startsWith(root) && (path.size() == root.size() || path.at(root.size()) == '/'))
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+const MountEntry *MountTable::find(quint64 deviceId) const
+{
+    int index = deviceIdToIndex.value(deviceId, -1);
+
+    return index < 0 ? nullptr : &entries.at(index);
+}
+
+// 缓存整个进程共享的挂载表，在 /proc/self/mountinfo 变化时（poll 返回 POLLPRI）更新
+class MountTableCache : public QThread
+{
+public:
+    MountTableCache();
+    ~MountTableCache();
+
+    std::shared_ptr<const MountTable> table() const;
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    bool reload();
+
+    std::shared_ptr<const MountTable> mountTable;
+    int mountInfoFd = -1;
+    int wakeupPipe[2] = {-1, -1};
+};
+
+MountTableCache::MountTableCache()
+{
+    mountInfoFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+
+    if (mountInfoFd < 0 || !reload() || ::pipe2(wakeupPipe, O_CLOEXEC) != 0) {
+        qWarning() << "Failed to watch the mount table, fallback to QStorageInfo";
+
+        // 无法监听变化时不使用缓存
+        std::atomic_store(&mountTable, std::shared_ptr<const MountTable>());
+
+        return;
+    }
+
+    start();
+}
+
+MountTableCache::~MountTableCache()
+{
+    if (isRunning()) {
+        const char ch = 0;
+
+        if (::write(wakeupPipe[1], &ch, 1) != 1)
+            terminate();
+
+        wait();
+    }
+
+    for (int fd : {mountInfoFd, wakeupPipe[0], wakeupPipe[1]}) {
+        if (fd >= 0)
+            ::close(fd);
+    }
+}
+
+std::shared_ptr<const MountTable> MountTableCache::table() const
+{
+    return std::atomic_load(&mountTable);
+}
+
+void MountTableCache::run()
+{
+    forever {
+        pollfd fds[2] = {{mountInfoFd, POLLPRI, 0}, {wakeupPipe[0], POLLIN, 0}};
+
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return;
+        }
+
+        if (fds[1].revents)
+            return;
+
+        if (fds[0].revents & (POLLPRI | POLLERR)) {
+            // 读取文件以清除变化的状态
+            reload();
+        }
+    }
+}
+
+bool MountTableCache::reload()
+{
+    if (::lseek(mountInfoFd, 0, SEEK_SET) < 0)
+        return false;
+
+    QByteArray data;
+    char buffer[4096];
+
+    forever {
+        const ssize_t size = ::read(mountInfoFd, buffer, sizeof(buffer));
+
+        if (size < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        if (size == 0)
+            break;
+
+        data.append(buffer, size);
+    }
+
+    std::atomic_store(&mountTable, std::shared_ptr<const MountTable>(new MountTable(data)));
+
+    return true;
+}
+
+}
+
+Q_GLOBAL_STATIC(MountTableCache, mountTableCache)
+
+// 从缓存的挂载表中查找路径所在的挂载点，返回的指针在 table 释放前有效
+static const MountEntry *findMountEntry(const MountTable &table, const QString &path)
+{
+    const MountEntry *entry = table.find(path);
+
+    // 不访问 gvfs 中的文件，避免阻塞
+    if (entry && entry->fileSystemType == "fuse.gvfsd-fuse")
+        return entry;
+
+    // 路径中可能含有指向其它设备的符号链接，使用文件所在的设备来查找
+    struct stat file_stat;
+
+    if (::stat(QFile::encodeName(path).constData(), &file_stat) == 0) {
+        if (const MountEntry *device_entry = table.find(static_cast<quint64>(file_stat.st_dev)))
+            return device_entry;
+    }
+
+    return entry;
+}
+
 static QString preprocessPath(const QString &path, DStorageInfo::PathHints hints)
 {
     QFileInfo info(path);
@@ -309,6 +568,13 @@ bool DStorageInfo::isLocalDevice(const QString &path)
     if (regExp.match(path, 0, QRegularExpression::NormalMatch, QRegularExpression::DontCheckSubjectStringMatchOption).hasMatch())
         return false;
 
+    if (const std::shared_ptr<const MountTable> table = mountTableCache->table()) {
+        const MountEntry *entry = findMountEntry(*table, QFileInfo(path).absoluteFilePath());
+
+        if (entry)
+            return entry->device.startsWith("/dev/");
+    }
+
     return DStorageInfo(path).device().startsWith("/dev/");
 }
 
@@ -329,6 +595,21 @@ bool DStorageInfo::isLowSpeedDevice(const QString &path)
             return true;
     }
 
+    if (const std::shared_ptr<const MountTable> table = mountTableCache->table()) {
+        const QString &file_path = QFileInfo(path).absoluteFilePath();
+        const MountEntry *entry = findMountEntry(*table, file_path);
+
+        if (entry) {
+            if (entry->fileSystemType != "fuse.gvfsd-fuse")
+                return false;
+
+            // gvfs 的每个挂载都是 gvfs 根目录下名为 "scheme:..." 的子目录
+            const QString &name = file_path.mid(entry->rootPath.size() + 1).section('/', 0, 0);
+
+            return name.startsWith("mtp:") || name.startsWith("gphoto:") || name.startsWith("gphoto2:");
+        }
+    }
+
     return DStorageInfo(path).isLowSpeedDevice();
 }
 
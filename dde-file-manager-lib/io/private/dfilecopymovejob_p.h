@@ -25,9 +25,14 @@
 #include "dstorageinfo.h"
 
 #include <QWaitCondition>
+#include <QMutex>
 #include <QPointer>
 #include <QStack>
 #include <QElapsedTimer>
+#include <QThreadPool>
+#include <QFuture>
+#include <QQueue>
+#include <QAtomicInteger>
 
 typedef QExplicitlySharedDataPointer<DAbstractFileInfo> DAbstractFileInfoPointer;
 
@@ -58,16 +63,25 @@ public:
         QPair<DUrl, DUrl> url;
     };
 
+    struct SmallFileCopyTask {
+        DUrl from;
+        DAbstractFileInfoPointer sourceInfo;
+        DAbstractFileInfoPointer targetInfo;
+        // 提交此任务时所在的目标目录，复制失败后在此目录下重新处理
+        DAbstractFileInfoPointer targetDirectoryInfo;
+        DirectoryInfo directory;
+        qint64 size;
+        QFuture<bool> result;
+    };
+
     DFileCopyMoveJobPrivate(DFileCopyMoveJob *qq);
     ~DFileCopyMoveJobPrivate();
 
     static QString errorToString(DFileCopyMoveJob::Error error);
-    // 返回当前线程已经往block设备写入的数据，返回的是本次和上次间隔时间内写入的大小
-    static qint64 getWriteBytes(long tid);
-    qint64 getWriteBytes() const;
     // 返回当前目标设备已写入扇区总数
     // /sys/dev/block/[x:x]/stat 的第7个字段
     // https://www.kernel.org/doc/Documentation/iostats.txt
+    // 调用时需持有 targetStatFdLock
     qint64 getSectorsWritten() const;
     // 返回已写入数据大小，根据多种情况，用不同的方式获取此数据
     qint64 getCompletedDataSize() const;
@@ -87,10 +101,30 @@ public:
     bool doProcess(const DUrl &from, DAbstractFileInfoPointer source_info, const DAbstractFileInfo *target_info);
     bool mergeDirectory(DFileHandler *handler, const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo);
     bool doCopyFile(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo, int blockSize = 1048576);
+#ifdef Q_OS_LINUX
+    enum KernelCopyResult {
+        KernelCopyUnsupported, // 未复制任何数据，需要改用普通的读写方式复制
+        KernelCopyFinished,
+        KernelCopySkipped,
+        KernelCopyFailed
+    };
+
+    bool canUseKernelCopy() const;
+    KernelCopyResult kernelCopyFile(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo,
+                                    int fromFd, int toFd, int blockSize, bool *reflinked);
+#endif
     bool doRemoveFile(DFileHandler *handler, const DAbstractFileInfo *fileInfo);
     bool doRenameFile(DFileHandler *handler, const DAbstractFileInfo *oldInfo, const DAbstractFileInfo *newInfo);
     bool doLinkFile(DFileHandler *handler, const DAbstractFileInfo *fileInfo, const QString &linkPath);
 
+    bool canCopyInParallel(const DAbstractFileInfo *sourceInfo, const DAbstractFileInfo *targetInfo, qint64 size) const;
+    void copySmallFileInParallel(const DUrl &from, const DAbstractFileInfoPointer &sourceInfo,
+                                 const DAbstractFileInfo *targetDirectoryInfo,
+                                 const DAbstractFileInfoPointer &targetInfo, qint64 size);
+    // 按提交的顺序处理已完成的并行复制任务，直到队列中剩余的任务不超过 keepCount 个，
+    // retryFailed 为 true 时，复制失败的文件会按普通的流程重新处理
+    bool completeSmallFileCopies(int keepCount, bool retryFailed = true);
+
     bool process(const DUrl &from, const DAbstractFileInfo *target_info);
     bool process(const DUrl &from, const DAbstractFileInfoPointer &source_info, const DAbstractFileInfo *target_info);
     bool copyFile(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo, int blockSize = 1048576);
@@ -110,6 +144,8 @@ public:
 
     DFileCopyMoveJob *q_ptr;
 
+    // 任务线程和并行复制的线程暂停时都在此等待，唤醒前需要先锁住 waitMutex
+    QMutex waitMutex;
     QWaitCondition waitCondition;
 
     DFileCopyMoveJob::Handle *handle = nullptr;
@@ -123,16 +159,14 @@ public:
     DUrlList sourceUrlList;
     DUrlList targetUrlList;
     DUrl targetUrl;
-    // 是否可以使用 /pric/[pid]/task/[tid]/io 文件中的的 writeBytes 字段的值作为判断已写入数据的依据
-    qint8 canUseWriteBytes : 1;
     // 目标磁盘设备是不是可移除或者热插拔设备
-    qint8 targetIsRemovable : 1;
-    // 逻辑扇区大小
-    qint16 targetLogSecionSize = 512;
+    bool targetIsRemovable = false;
     // 记录任务开始时目标磁盘设备已写入扇区数
     qint64 targetDeviceStartSectorsWritten;
-    // /sys/dev/block/x:x
-    QString targetSysDevPath;
+    // 任务期间保持打开的 /sys/dev/block/x:x/stat 文件
+    int targetStatFd = -1;
+    // 更新进度的定时器在其它线程中读取 targetStatFd，读取和关闭它时都要持有此锁
+    mutable QMutex targetStatFdLock;
     // 目标设备所挂载的根目录
     QString targetRootPath;
 
@@ -142,10 +176,22 @@ public:
 
     QStack<JobInfo> jobStack;
     QStack<DirectoryInfo> directoryStack;
+    // 复制目录时，其中的小文件交给线程池并行复制，复制结果（包括失败后的重试和错误处理）
+    // 仍按提交的顺序在任务线程中处理，以保证已完成文件列表和错误处理的顺序不变
+    bool deferSmallFileCopy = false;
+    // 正在处理已完成的并行复制任务，重新处理失败的文件时不能再次进入
+    bool completingSmallFileCopies = false;
+    QThreadPool smallFileCopyPool;
+    QQueue<SmallFileCopyTask> smallFileCopyQueue;
+    // 复制大文件时用于预读源文件的线程
+    QThreadPool readAheadPool;
+    // 单线程复制和完整性校验时复用的读取缓冲区
+    QByteArray copyBuffer;
     QList<QPair<DUrl, DUrl>> completedFileList;
     QList<QPair<DUrl, DUrl>> completedDirectoryList;
     int completedFilesCount = 0;
-    qint64 completedDataSize = 0;
+    // 任务线程写入，更新进度的定时器在其它线程读取
+    QAtomicInteger<qint64> completedDataSize;
     // 已经写入到block设备的总大小
     qint64 completedDataSizeOnBlockDevice = 0;
     QPair<qint64 /*total*/, qint64 /*writed*/> currentJobDataSizeInfo;
@@ -154,8 +200,6 @@ public:
     QTimer *updateSpeedTimer = nullptr;
     int timeOutCount = 0;
     bool needUpdateProgress = false;
-    // 线程id
-    long tid = -1;
 
     Q_DECLARE_PUBLIC(DFileCopyMoveJob)
 };
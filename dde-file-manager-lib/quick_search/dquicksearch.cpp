@@ -24,7 +24,11 @@
 #include <string>
 #include <fstream>
 #include <iomanip>
+#include <chrono>
+#include <condition_variable>
+#include <tuple>
 #include <sys/sysmacros.h>
+#include <fcntl.h>
 
 #include <zlib.h>
 
@@ -45,10 +49,21 @@ extern "C"
 #include "dstorageinfo.h"
 
 #include <QDebug>
+#include <QtConcurrent/QtConcurrent>
 
 DFM_USE_NAMESPACE
 
 #define MAX_RESULTS 100
+///###: the count of names searched by a task of a parallel search.
+#define SEARCH_SHARD_SIZE 50000
+///###: seconds.
+#define SEARCH_CURSOR_TIMEOUT 60
+///###: milliseconds, only the searches in this process wait for results, the daemon returns at once.
+#define SEARCH_FETCH_WAIT_TIME 200
+///###: milliseconds, the changes are saved to the lft files after this delay.
+#define INDEX_SAVE_DELAY 30000
+///###: how many times a search is started again when the index was changed under it.
+#define SEARCH_RESTART_LIMIT 3
 
 #define ACT_NEW_FILE    0
 #define ACT_NEW_LINK    1
@@ -62,17 +77,97 @@ DFM_USE_NAMESPACE
 
 
 
+///###: the keywords of a query which are compiled once for a search.
+///###: plain keywords and "*" wildcards are matched as case-insensitive literals, regex is only used for the others.
+class QueryMatcher
+{
+public:
+    QueryMatcher(const QString &key_words, const QByteArray &posix_query)
+    {
+        if (split_literals(key_words)) {
+            m_valid = true;
+            return;
+        }
+
+        m_use_regex = true;
+        m_valid = regcomp(&m_compiled, posix_query.constData(), REG_ICASE | REG_EXTENDED | REG_NOSUB) == 0;
+    }
+
+    ~QueryMatcher()
+    {
+        if (m_use_regex && m_valid) {
+            regfree(&m_compiled);
+        }
+    }
+
+    QueryMatcher(const QueryMatcher &) = delete;
+    QueryMatcher &operator=(const QueryMatcher &) = delete;
+
+    inline bool isValid() const noexcept
+    {
+        return m_valid;
+    }
+
+    bool match(const char *name) const
+    {
+        if (m_use_regex) {
+            return regexec(&m_compiled, name, 0, nullptr, 0) == REG_NOERROR;
+        }
+
+        ///###: etc: "st*r" matches the names which contain "st" and then "r".
+        const char *pos{ name };
+
+        for (const QByteArray &literal : m_literals) {
+            pos = strcasestr(pos, literal.constData());
+
+            if (!pos) {
+                return false;
+            }
+
+            pos += literal.size();
+        }
+
+        return true;
+    }
+
+private:
+    bool split_literals(const QString &key_words)
+    {
+        static const QString regex_chars{ ".[]()+?{}|^$\\" };
+
+        for (const QChar &ch : key_words) {
+            if (regex_chars.contains(ch)) {
+                return false;
+            }
+
+            ///###: the letters which are not ascii need the case folding of the locale.
+            if (ch.unicode() >= 0x80 && ch.toLower() != ch.toUpper()) {
+                return false;
+            }
+        }
+
+        for (const QString &literal : key_words.split(QChar('*'), QString::SkipEmptyParts)) {
+            m_literals.push_back(literal.toLocal8Bit());
+        }
+
+        return true;
+    }
+
+    std::vector<QByteArray> m_literals{};
+    bool m_use_regex{ false };
+    bool m_valid{ false };
+    regex_t m_compiled;
+};
+
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif //__cplusplus
 
-int match_regex(const char *name, void *query)
+int match_query(const char *name, void *query)
 {
-    regmatch_t subs[1024];
-    memset(subs, 0, sizeof(subs));
-    regex_t *compiled = (regex_t *)query;
-    return (regexec(compiled, name, 1024, subs, 0) == REG_NOERROR) ? 1 : 0;
+    return static_cast<QueryMatcher *>(query)->match(name) ? 1 : 0;
 }
 
 
@@ -284,6 +379,27 @@ static QByteArray grep_regx_to_posix(const QByteArray &posix_reg_str)
 }
 
 
+static std::size_t count_adler32_of_file(const QByteArray &file_path) noexcept
+{
+    std::size_t adler32_value{ 0 };
+    int fd{ open(file_path.constData(), O_RDONLY | O_CLOEXEC) };
+
+    if (fd >= 0) {
+        std::vector<unsigned char> buffer(1 << 20);
+        adler32_value = adler32(0L, NULL, 0);
+        ssize_t size{ 0 };
+
+        while ((size = read(fd, buffer.data(), buffer.size())) > 0) {
+            adler32_value = adler32(adler32_value, buffer.data(), size);
+        }
+
+        close(fd);
+    }
+
+    return adler32_value;
+}
+
+
 }// end namespace detail.
 
 // this struct calls "ScopedPointerFsbufDeleter" to delete the fs_buf pointer
@@ -294,322 +410,697 @@ struct ScopedPointerFsbufDeleter
     }
 };
 
-// this struct calls "myCustomDeallocator" to delete the regex_t pointer
-struct ScopedPointerRegextDeleter
+///###: applies a batch of changes to the resident indexes, the write lock of an index is held until the paths move to another one.
+class DQuickSearch::ChangeBatch
 {
-    static inline void cleanup(regex_t *pointer) {
-        regfree(pointer);
+public:
+    explicit ChangeBatch(DQuickSearch *quick_search)
+        : m_quick_search{ quick_search } {}
+
+    ~ChangeBatch()
+    {
+        finish_index();
+    }
+
+    ChangeBatch(const ChangeBatch &) = delete;
+    ChangeBatch &operator=(const ChangeBatch &) = delete;
+
+    fs_buf *buffer_of(const QByteArray &path)
+    {
+        std::shared_ptr<ResidentIndex> index{ m_quick_search->index_of_changed_path(path) };
+
+        if (index != m_index) {
+            finish_index();
+
+            if (index) {
+                index->lock.lockForWrite();
+                m_index = index;
+            }
+        }
+
+        return m_index ? m_index->buf.get() : nullptr;
+    }
+
+    ///###: a change could not be applied to the current index, it has to be rebuilt from the file system.
+    void lose_changes()
+    {
+        if (m_index) {
+            m_index->changes_lost.store(true, std::memory_order_release);
+        }
     }
+
+private:
+    void finish_index()
+    {
+        if (!m_index) {
+            return;
+        }
+
+        ++m_index->generation;
+        m_index->shard_offs_dirty.store(true, std::memory_order_release);
+        m_index->lock.unlock();
+        m_index.reset();
+
+        QMetaObject::invokeMethod(&m_quick_search->m_save_timer, "start");
+    }
+
+    DQuickSearch *m_quick_search{ nullptr };
+    std::shared_ptr<ResidentIndex> m_index{ nullptr };
+};
+
+struct DQuickSearch::SearchCursor
+{
+    std::shared_ptr<ResidentIndex> index{ nullptr };
+    std::uint64_t generation{ 0 };
+    QString key_words{};
+    QByteArray query{};
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> shards{};
+    std::atomic<bool> canceled{ false };
+    ///###: the index was changed after the search began, the results are incomplete.
+    std::atomic<bool> interrupted{ false };
+
+    std::mutex mutex{};
+    std::condition_variable condition{};
+    std::vector<QList<QString>> shard_results{};
+    std::vector<bool> shard_finished{};
+    std::size_t current_shard{ 0 };
+    std::chrono::steady_clock::time_point last_access{};
 };
 
 DQuickSearch::DQuickSearch(QObject *const parent)
     : QObject{ parent }
 {
     std::ios_base::sync_with_stdio(false);
+
+    m_save_timer.setSingleShot(true);
+    m_save_timer.setInterval(INDEX_SAVE_DELAY);
+
+    connect(&m_save_timer, &QTimer::timeout, this, [this] {
+        bool saving{ false };
+
+        ///###: try again later if the last saving is not finished.
+        if (!m_saving.compare_exchange_strong(saving, true)) {
+            m_save_timer.start();
+            return;
+        }
+
+        QtConcurrent::run([this] {
+            save_resident_indexes();
+            m_saving.store(false, std::memory_order_release);
+        });
+    });
 }
 
 
 QList<QString> DQuickSearch::search(const QString &local_path, const QString &key_words)
 {
     QList<QString> searched_list{};
+    quint64 cursor_id{ beginSearch(local_path, key_words) };
+    bool finished{ cursor_id == 0 };
+    int restart_count{ 0 };
+
+    while (!finished) {
+        bool interrupted{ false };
+        searched_list += fetchSearchResult(cursor_id, INT_MAX, &finished, &interrupted, SEARCH_FETCH_WAIT_TIME);
+
+        ///###: nothing has been returned yet, so search again from the beginning.
+        if (interrupted && restart_count++ < SEARCH_RESTART_LIMIT) {
+            searched_list.clear();
+            cursor_id = beginSearch(local_path, key_words);
+            finished = cursor_id == 0;
+        }
+    }
+
+#ifdef QT_DEBUG
+    qDebug() << searched_list;
+#endif //QT_DEBUG
+
+    return searched_list;
+}
 
+quint64 DQuickSearch::beginSearch(const QString &local_path, const QString &key_words)
+{
     if (!m_readyFlag.load(std::memory_order_consume)) {
-        return searched_list;
+        return 0;
     }
 
 #ifdef QT_DEBUG
     qDebug() << local_path << key_words;
 #endif //QT_DEBUG
 
-    if (QFileInfo::exists(local_path) && !key_words.isEmpty()) {
-        QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(local_path) };
-        std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
+    if (!QFileInfo::exists(local_path) || key_words.isEmpty()) {
+        return 0;
+    }
 
-        ///###: adler32 check.
-        std::size_t adler32_value_backup{ DQuickSearch::read_adler32_value(pos->first) };
-        std::size_t adler32_value_now{ DQuickSearch::count_adler32(pos->first) };
+    std::shared_ptr<ResidentIndex> index{ index_of_path(local_path) };
 
-        if (adler32_value_backup != adler32_value_now) {
-            return searched_list;
-        }
+    if (!index) {
+        return 0;
+    }
 
+    std::shared_ptr<SearchCursor> cursor{ new SearchCursor };
+    cursor->index = index;
+    cursor->key_words = key_words;
+    cursor->query = detail::grep_regx_to_posix(key_words.toLocal8Bit());
 
-        if (pos != m_mount_point_and_lft_buf.cend()) {
-            std::lock_guard<std::mutex> raii_lock{ m_mutex };
-            fs_buf *buf{ nullptr };
-            load_fs_buf(&buf, pos->second.toLocal8Bit().constData());
-            QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buf);
-            Q_UNUSED(sp); Q_UNUSED(raii_lock);
+    if (index->shard_offs_dirty.load(std::memory_order_consume)) {
+        QWriteLocker raii_write_lock{ &index->lock };
+        Q_UNUSED(raii_write_lock);
 
-            if (buf) {
-                QByteArray query_str{ key_words.toLocal8Bit() };
-                QByteArray local_path_8bit{ local_path.toLocal8Bit() };
-                std::uint32_t path_off{ 0 };
-                std::uint32_t end_off{ 0 };
-                std::uint32_t start_off{ 0 };
-                query_str = detail::grep_regx_to_posix(query_str);
-                regex_t compiled;
-                QScopedPointer<regex_t, ScopedPointerRegextDeleter> sp_compiled(&compiled);
-                Q_UNUSED(sp_compiled);
+        if (index->shard_offs_dirty.load(std::memory_order_consume)) {
+            count_shard_offs(index.get());
+        }
+    }
 
-                int err{ regcomp(&compiled, query_str.constData(), REG_ICASE | REG_EXTENDED) };
+    {
+        QReadLocker raii_read_lock{ &index->lock };
+        Q_UNUSED(raii_read_lock);
+        cursor->generation = index->generation.load();
 
-#ifdef QT_DEBUG
-                qDebug() << local_path_8bit;
-                qDebug() << err;
-#endif //QT_DEBUG
+        QByteArray local_path_8bit{ local_path.toLocal8Bit() };
+        std::uint32_t path_off{ 0 };
+        std::uint32_t end_off{ 0 };
+        std::uint32_t start_off{ 0 };
 
-                get_path_range(buf, local_path_8bit.data(), &path_off,  &start_off, &end_off);
+        get_path_range(index->buf.get(), local_path_8bit.data(), &path_off,  &start_off, &end_off);
 
-                end_off = end_off == 0 ? get_tail(buf) : end_off;
-                start_off = start_off == 0 ? first_name(buf) : start_off;
-                std::uint32_t name_offs[MAX_RESULTS] {};
-                std::uint32_t count{ MAX_RESULTS };
+        end_off = end_off == 0 ? get_tail(index->buf.get()) : end_off;
+        start_off = start_off == 0 ? first_name(index->buf.get()) : start_off;
 
 #ifdef QT_DEBUG
-                qDebug() << start_off << end_off << path_off;
+        qDebug() << start_off << end_off << path_off;
 #endif //QT_DEBUG
 
-                if (!err) {
+        std::uint32_t shard_start{ start_off };
 
-                    search_files(buf, &start_off, end_off, &compiled, match_regex, name_offs, &count);
-
-                    char path[PATH_MAX];
-                    for (std::uint32_t i = 0; i < count; i++) {
-                        char *file_or_dir_name{ get_path_by_name_off(buf, name_offs[i], path, sizeof(path)) };
+        for (std::uint32_t off : index->shard_offs) {
+            if (off <= shard_start) {
+                continue;
+            }
 
-                        if (file_or_dir_name && !DQuickSearchFilter::instance()->whetherFilterCurrentFile(QByteArray{ file_or_dir_name })) {
-                            searched_list.push_back(QString{ file_or_dir_name });
-                        }
-                    }
+            if (off >= end_off) {
+                break;
+            }
 
-                    std::vector<std::uint32_t> vec_names_off{};
+            cursor->shards.emplace_back(shard_start, off);
+            shard_start = off;
+        }
 
-                    while (count == MAX_RESULTS) {
-                        search_files(buf, &start_off, end_off, &compiled, match_regex, name_offs, &count);
+        cursor->shards.emplace_back(shard_start, end_off);
+    }
 
-                        for (std::size_t index = 0; index < count; ++index) {
-                            vec_names_off.push_back(name_offs[index]);
-                        }
-                    }
+    cursor->shard_results.resize(cursor->shards.size());
+    cursor->shard_finished.resize(cursor->shards.size(), false);
+    cursor->last_access = std::chrono::steady_clock::now();
 
-                    for (std::uint32_t off_beg : vec_names_off) {
-                        char *file_or_dir_name{ get_path_by_name_off(buf, off_beg, path, sizeof(path)) };
+    quint64 cursor_id{ 0 };
 
-                        if (file_or_dir_name && !DQuickSearchFilter::instance()->whetherFilterCurrentFile(QByteArray{ file_or_dir_name })) {
-                            searched_list.push_back(QString{ file_or_dir_name });
-                        }
-#ifdef QT_DEBUG
-                        qDebug() << file_or_dir_name;
-#endif //QT_DEBUG
-                    }
+    {
+        std::lock_guard<std::mutex> raii_lock{ m_cursor_mutex };
+        Q_UNUSED(raii_lock);
 
-#ifdef QT_DEBUG
-                    qDebug() << searched_list;
-#endif //QT_DEBUG
+        ///###: the clients which never fetched all results.
+        for (std::map<quint64, std::shared_ptr<SearchCursor>>::iterator itr = m_cursors.begin(); itr != m_cursors.end();) {
+            std::unique_lock<std::mutex> raii_cursor_lock{ itr->second->mutex };
+            bool timeout{ cursor->last_access - itr->second->last_access > std::chrono::seconds{ SEARCH_CURSOR_TIMEOUT } };
+            raii_cursor_lock.unlock();
 
-                    return searched_list;
-                }
+            if (timeout) {
+                itr->second->canceled.store(true, std::memory_order_release);
+                itr = m_cursors.erase(itr);
+            } else {
+                ++itr;
             }
         }
+
+        cursor_id = ++m_last_cursor_id;
+        m_cursors[cursor_id] = cursor;
     }
 
-    return searched_list;
+    ///###: the shards are queued in order, so the first pages are usually ready first.
+    for (std::size_t shard = 0; shard < cursor->shards.size(); ++shard) {
+        QtConcurrent::run(&m_search_pool, &DQuickSearch::search_shard, cursor, shard);
+    }
+
+    return cursor_id;
 }
 
-void DQuickSearch::filesWereCreated(const QList<QByteArray> &files_path)
+QList<QString> DQuickSearch::fetchSearchResult(quint64 cursor_id, int max_count, bool *finished, bool *interrupted, int wait_time)
 {
-    if (!m_readyFlag.load(std::memory_order_consume)) {
-        return;
+    QList<QString> searched_list{};
+    std::shared_ptr<SearchCursor> cursor{ nullptr };
+
+    {
+        std::lock_guard<std::mutex> raii_lock{ m_cursor_mutex };
+        Q_UNUSED(raii_lock);
+        std::map<quint64, std::shared_ptr<SearchCursor>>::const_iterator pos{ m_cursors.find(cursor_id) };
+
+        if (pos != m_cursors.cend()) {
+            cursor = pos->second;
+        }
     }
 
-    if (files_path.isEmpty()) {
-        fs_change changes[10] {};
-        std::function<bool(const QString &)> update_adler32_backup{
-            [](const QString & mount_point)->bool
-            {
-                std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
-                if (adler32_value)
-                {
-                    bool value{ DQuickSearch::store_adler32_value(mount_point, adler32_value) };
-                    return value;
-                }
+    if (!cursor) {
+        *finished = true;
+        return searched_list;
+    }
 
-                return false;
-            }
-        };
+    std::unique_lock<std::mutex> raii_lock{ cursor->mutex };
+    std::function<bool()> has_result{
+        [&cursor]()->bool
+        {
+            return cursor->current_shard == cursor->shards.size() || cursor->shard_finished[cursor->current_shard];
+        }
+    };
 
-        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+    if (wait_time > 0) {
+        cursor->condition.wait_for(raii_lock, std::chrono::milliseconds{ wait_time }, has_result);
+    }
 
-        for (const QByteArray &path : files_path) {
-            QString path_str{ QString::fromLocal8Bit(path) };
-            QFileInfo file_info{ path_str };
+    ///###: the rest of the results can not be trusted, the client has to search again.
+    if (cursor->interrupted.load(std::memory_order_acquire)) {
+        raii_lock.unlock();
+        *finished = true;
 
-            if (m_flag.load(std::memory_order_consume)) {
-                m_flag.store(false, std::memory_order_release);
-            }
+        if (interrupted) {
+            *interrupted = true;
+        }
 
-            QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(path) };
-            std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
+        std::lock_guard<std::mutex> raii_cursor_lock{ m_cursor_mutex };
+        Q_UNUSED(raii_cursor_lock);
 
-            if (pos == m_mount_point_and_lft_buf.cend()) {
-                continue;
-            }
+        m_cursors.erase(cursor_id);
 
-            fs_buf *buf{ nullptr };
-            load_fs_buf(&buf, pos->second.toLocal8Bit().constData());
-            QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buf);
-            Q_UNUSED(sp);
+        return searched_list;
+    }
 
-            if (buf) {
+    while (cursor->current_shard < cursor->shards.size() && cursor->shard_finished[cursor->current_shard]
+            && searched_list.size() < max_count) {
+        QList<QString> &shard_result = cursor->shard_results[cursor->current_shard];
+        int count{ qMin(max_count - searched_list.size(), shard_result.size()) };
 
-                if (file_info.isSymLink()) {
-                    insert_path(buf, const_cast<char *>(path.data()), ACT_NEW_SYMLINK, changes);
-                    save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+        searched_list += shard_result.mid(0, count);
+        shard_result.erase(shard_result.begin(), shard_result.begin() + count);
 
-                    if (!update_adler32_backup(pos->first)) {
-                        m_mount_point_and_lft_buf.erase(pos);
-                    }
+        if (shard_result.isEmpty()) {
+            ++cursor->current_shard;
+        }
+    }
 
-                    continue;
-                }
+    cursor->last_access = std::chrono::steady_clock::now();
+    *finished = cursor->current_shard == cursor->shards.size();
+    raii_lock.unlock();
 
-                if (file_info.isFile()) {
-                    insert_path(buf, const_cast<char *>(path.data()), ACT_NEW_FILE, changes);
-                    save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+    if (*finished) {
+        std::lock_guard<std::mutex> raii_cursor_lock{ m_cursor_mutex };
+        Q_UNUSED(raii_cursor_lock);
 
-                    if (!update_adler32_backup(pos->first)) {
-                        m_mount_point_and_lft_buf.erase(pos);
-                    }
+        m_cursors.erase(cursor_id);
+    }
 
-                    continue;
-                }
+    return searched_list;
+}
 
-                if (file_info.isDir()) {
-                    insert_path(buf, const_cast<char *>(path.data()), ACT_NEW_FOLDER, changes);
-                    save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+void DQuickSearch::cancelSearch(quint64 cursor_id)
+{
+    std::lock_guard<std::mutex> raii_lock{ m_cursor_mutex };
+    Q_UNUSED(raii_lock);
+    std::map<quint64, std::shared_ptr<SearchCursor>>::iterator pos{ m_cursors.find(cursor_id) };
 
-                    if (!update_adler32_backup(pos->first)) {
-                        m_mount_point_and_lft_buf.erase(pos);
+    if (pos != m_cursors.end()) {
+        pos->second->canceled.store(true, std::memory_order_release);
+        m_cursors.erase(pos);
+    }
+}
+
+void DQuickSearch::search_shard(const std::shared_ptr<SearchCursor> &cursor, std::size_t shard)
+{
+    QList<QString> searched_list{};
+
+    if (!cursor->canceled.load(std::memory_order_consume)) {
+        ///###: regexec locks the compiled pattern, so every shard compiles its own one.
+        QueryMatcher matcher{ cursor->key_words, cursor->query };
+
+        if (matcher.isValid()) {
+            QReadLocker raii_read_lock{ &cursor->index->lock };
+            Q_UNUSED(raii_read_lock);
+
+            ///###: the offsets of the shards were moved by the changes applied after the search began.
+            if (cursor->index->generation.load() != cursor->generation) {
+                cursor->interrupted.store(true, std::memory_order_release);
+                cursor->canceled.store(true, std::memory_order_release);
+            }
+
+            fs_buf *buf{ cursor->index->buf.get() };
+            std::uint32_t start_off{ cursor->shards[shard].first };
+            std::uint32_t end_off{ cursor->shards[shard].second };
+            std::uint32_t name_offs[MAX_RESULTS] {};
+            std::uint32_t count{ MAX_RESULTS };
+            char path[PATH_MAX];
+
+            while (!cursor->canceled.load(std::memory_order_consume)) {
+                count = MAX_RESULTS;
+                search_files(buf, &start_off, end_off, &matcher, match_query, name_offs, &count);
+
+                for (std::uint32_t index = 0; index < count; ++index) {
+                    char *file_or_dir_name{ get_path_by_name_off(buf, name_offs[index], path, sizeof(path)) };
+
+                    if (file_or_dir_name && !DQuickSearchFilter::instance()->whetherFilterCurrentFile(QByteArray{ file_or_dir_name })) {
+                        searched_list.push_back(QString{ file_or_dir_name });
                     }
+                }
 
-                    continue;
+                if (count != MAX_RESULTS) {
+                    break;
                 }
             }
         }
     }
+
+    {
+        std::lock_guard<std::mutex> raii_lock{ cursor->mutex };
+        Q_UNUSED(raii_lock);
+
+        cursor->shard_results[shard] = std::move(searched_list);
+        cursor->shard_finished[shard] = true;
+    }
+
+    cursor->condition.notify_all();
 }
 
+std::shared_ptr<DQuickSearch::ResidentIndex> DQuickSearch::index_of_path(const QString &local_path)
+{
+    QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(local_path) };
+    std::lock_guard<std::mutex> raii_lock{ m_mutex };
+    Q_UNUSED(raii_lock);
+    std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
 
-void DQuickSearch::filesWereDeleted(const QList<QByteArray> &files_path)
+    if (pos != m_mount_point_and_lft_buf.cend()) {
+        return resident_index(pos->first, pos->second);
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<DQuickSearch::ResidentIndex> DQuickSearch::resident_index(const QString &mount_point, const QString &lft_file)
 {
-    if (!m_readyFlag.load(std::memory_order_consume)) {
-        return;
+    QByteArray lft_file_8bit{ lft_file.toLocal8Bit() };
+    struct stat file_stat;
+
+    if (stat(lft_file_8bit.constData(), &file_stat) != 0) {
+        m_resident_indexes.erase(lft_file);
+        return nullptr;
     }
 
-    if (files_path.isEmpty()) {
-        fs_change changes[10] {};
-        std::uint32_t change_count{  sizeof(changes) / sizeof(fs_change) };
-        std::function<bool(const QString &)> update_adler32_backup{
-            [](const QString & mount_point)->bool
-            {
-                std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
-                if (adler32_value)
-                {
-                    bool value{ DQuickSearch::store_adler32_value(mount_point, adler32_value) };
-                    return value;
-                }
+    std::map<QString, std::shared_ptr<ResidentIndex>>::const_iterator pos{ m_resident_indexes.find(lft_file) };
 
-                return false;
-            }
-        };
+    if (pos != m_resident_indexes.cend() && pos->second->inode == file_stat.st_ino && pos->second->size == file_stat.st_size
+            && pos->second->mtime_ns == file_stat.st_mtim.tv_sec * 1000000000LL + file_stat.st_mtim.tv_nsec) {
+        return pos->second;
+    }
+
+    ///###: the lft file was changed on disk, check it once before loading it.
+    if (DQuickSearch::read_adler32_value(mount_point) != DQuickSearch::count_adler32(mount_point)) {
+        m_resident_indexes.erase(lft_file);
+        return nullptr;
+    }
+
+    fs_buf *buf{ nullptr };
+
+    if (load_fs_buf(&buf, lft_file_8bit.constData()) != 0 || !buf) {
+        m_resident_indexes.erase(lft_file);
+        return nullptr;
+    }
+
+    keep_resident(lft_file, buf);
+
+    return m_resident_indexes[lft_file];
+}
+
+void DQuickSearch::keep_resident(const QString &lft_file, fs_buf *buf)
+{
+    std::shared_ptr<ResidentIndex> index{ new ResidentIndex };
+    index->buf.reset(buf, free_fs_buf);
+
+    struct stat file_stat;
+
+    if (stat(lft_file.toLocal8Bit().constData(), &file_stat) == 0) {
+        index->inode = file_stat.st_ino;
+        index->size = file_stat.st_size;
+        index->mtime_ns = file_stat.st_mtim.tv_sec * 1000000000LL + file_stat.st_mtim.tv_nsec;
+    }
+
+    count_shard_offs(index.get());
+
+    ///###: the searches which are running still hold the old one.
+    m_resident_indexes[lft_file] = index;
+}
+
+void DQuickSearch::count_shard_offs(ResidentIndex *index)
+{
+    fs_buf *buf{ index->buf.get() };
+    std::uint32_t tail{ get_tail(buf) };
+    std::uint32_t name_count{ 0 };
+
+    index->shard_offs.clear();
+
+    for (std::uint32_t name_off = first_name(buf); name_off < tail; name_off = next_name(buf, name_off), ++name_count) {
+        if (name_count % SEARCH_SHARD_SIZE == 0) {
+            index->shard_offs.push_back(name_off);
+        }
+    }
+
+    index->shard_offs_dirty.store(false, std::memory_order_release);
+}
+
+std::shared_ptr<DQuickSearch::ResidentIndex> DQuickSearch::index_of_changed_path(const QByteArray &path)
+{
+    QString path_str{ QString::fromLocal8Bit(path) };
+    std::lock_guard<std::mutex> raii_lock{ m_mutex };
+    Q_UNUSED(raii_lock);
+    std::map<QString, QString>::const_iterator index_pos{ m_mount_point_and_lft_buf.cend() };
+
+    ///###: the longest indexed mount point which contains the path, it is much cheaper than DStorageInfo for every changed file.
+    for (std::map<QString, QString>::const_iterator pos = m_mount_point_and_lft_buf.cbegin(); pos != m_mount_point_and_lft_buf.cend(); ++pos) {
+        const QString &mount_point{ pos->first };
+
+        if (!path_str.startsWith(mount_point)) {
+            continue;
+        }
+
+        if (!mount_point.endsWith(QChar('/')) && path_str.size() > mount_point.size() && path_str.at(mount_point.size()) != QChar('/')) {
+            continue;
+        }
 
+        if (index_pos == m_mount_point_and_lft_buf.cend() || index_pos->first.size() < mount_point.size()) {
+            index_pos = pos;
+        }
+    }
+
+    if (index_pos == m_mount_point_and_lft_buf.cend()) {
+        return nullptr;
+    }
+
+    return resident_index(index_pos->first, index_pos->second);
+}
+
+void DQuickSearch::save_resident_indexes()
+{
+    std::vector<std::tuple<QString, QString, std::shared_ptr<ResidentIndex>>> changed_indexes{};
+    std::vector<std::tuple<QString, QString, std::shared_ptr<ResidentIndex>>> lost_indexes{};
+
+    {
         std::lock_guard<std::mutex> raii_lock{ m_mutex };
+        Q_UNUSED(raii_lock);
+
+        for (const std::pair<const QString, QString> &mount_point_and_lft : m_mount_point_and_lft_buf) {
+            std::map<QString, std::shared_ptr<ResidentIndex>>::const_iterator pos{ m_resident_indexes.find(mount_point_and_lft.second) };
 
-        for (const QByteArray &path : files_path) {
+            if (pos == m_resident_indexes.cend()) {
+                continue;
+            }
 
-            if (m_flag.load(std::memory_order_consume)) {
-                m_flag.store(false, std::memory_order_release);
+            ///###: do not save an index which misses some changes, build it again.
+            if (pos->second->changes_lost.load(std::memory_order_acquire)) {
+                lost_indexes.emplace_back(mount_point_and_lft.first, mount_point_and_lft.second, pos->second);
+            } else if (pos->second->generation.load() != pos->second->saved_generation) {
+                changed_indexes.emplace_back(mount_point_and_lft.first, mount_point_and_lft.second, pos->second);
             }
+        }
+    }
 
-            QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(path) };
-            std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
+    ///###: building a tree walks the whole partition, do it without m_mutex and only lock to replace the index.
+    for (const std::tuple<QString, QString, std::shared_ptr<ResidentIndex>> &lost_index : lost_indexes) {
+        const QString &mount_point{ std::get<0>(lost_index) };
+        const QString &lft_file{ std::get<1>(lost_index) };
+        const std::shared_ptr<ResidentIndex> &index{ std::get<2>(lost_index) };
+        QByteArray lft_file_8bit{ lft_file.toLocal8Bit() };
+        QByteArray temp_file{ lft_file_8bit + ".tmp" };
+        std::uint64_t generation{ index->generation.load() };
+        fs_buf *buffer{ build_lft(mount_point, temp_file) };
+
+        if (!buffer) {
+            qWarning() << "A error occured, when creating lft in: " << mount_point;
+            unlink(temp_file.constData());
+            continue;
+        }
 
+        QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buffer);
+        std::size_t adler32_value{ detail::count_adler32_of_file(temp_file) };
+        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+        Q_UNUSED(raii_lock);
+        std::map<QString, std::shared_ptr<ResidentIndex>>::const_iterator pos{ m_resident_indexes.find(lft_file) };
+
+        ///###: the index was rebuilt or removed while building.
+        if (!adler32_value || pos == m_resident_indexes.cend() || pos->second != index
+                || rename(temp_file.constData(), lft_file_8bit.constData()) != 0) {
+            unlink(temp_file.constData());
+            continue;
+        }
 
-            if (pos == m_mount_point_and_lft_buf.cend()) {
+        DQuickSearch::store_adler32_value(mount_point, adler32_value);
+        keep_resident(lft_file, sp.take());
+
+        ///###: the changes which were applied to the old index while walking may be missed by the new tree.
+        if (index->generation.load() != generation) {
+            m_resident_indexes[lft_file]->changes_lost.store(true, std::memory_order_release);
+        }
+    }
+
+    for (const std::tuple<QString, QString, std::shared_ptr<ResidentIndex>> &changed_index : changed_indexes) {
+        const QString &mount_point{ std::get<0>(changed_index) };
+        const QString &lft_file{ std::get<1>(changed_index) };
+        const std::shared_ptr<ResidentIndex> &index{ std::get<2>(changed_index) };
+        QByteArray lft_file_8bit{ lft_file.toLocal8Bit() };
+        QByteArray temp_file{ lft_file_8bit + ".tmp" };
+        std::uint64_t generation{ 0 };
+
+        {
+            QReadLocker raii_read_lock{ &index->lock };
+            Q_UNUSED(raii_read_lock);
+            generation = index->generation.load();
+
+            if (save_fs_buf(index->buf.get(), temp_file.constData()) != 0) {
+                unlink(temp_file.constData());
                 continue;
             }
+        }
 
-            fs_buf *buf{ nullptr };
-            std::basic_string<char> local_8bit{ path.toStdString() };
-            load_fs_buf(&buf, pos->second.toLocal8Bit().constData());
-            QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buf);
-            Q_UNUSED(sp);
+        std::size_t adler32_value{ detail::count_adler32_of_file(temp_file) };
+        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+        Q_UNUSED(raii_lock);
+        std::map<QString, std::shared_ptr<ResidentIndex>>::const_iterator pos{ m_resident_indexes.find(lft_file) };
 
-            if (buf) {
-                remove_path(buf, const_cast<char *>(local_8bit.data()), changes, &change_count);
-                save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+        ///###: the index was rebuilt or removed while saving.
+        if (pos == m_resident_indexes.cend() || pos->second != index || rename(temp_file.constData(), lft_file_8bit.constData()) != 0) {
+            unlink(temp_file.constData());
+            continue;
+        }
 
-                if (!update_adler32_backup(pos->first)) {
-                    m_mount_point_and_lft_buf.erase(pos);
-                }
-            }
+        DQuickSearch::store_adler32_value(mount_point, adler32_value);
+
+        ///###: the file is the same as the resident index, do not load it again.
+        struct stat file_stat;
+
+        if (stat(lft_file_8bit.constData(), &file_stat) == 0) {
+            index->inode = file_stat.st_ino;
+            index->size = file_stat.st_size;
+            index->mtime_ns = file_stat.st_mtim.tv_sec * 1000000000LL + file_stat.st_mtim.tv_nsec;
         }
+
+        index->saved_generation = generation;
     }
 }
 
-void DQuickSearch::filesWereRenamed(const QList<QPair<QByteArray, QByteArray> > &files_path)
+void DQuickSearch::filesWereCreated(const QList<QByteArray> &files_path)
 {
-    if (!m_readyFlag.load(std::memory_order_consume)) {
+    if (!m_readyFlag.load(std::memory_order_consume) || files_path.isEmpty()) {
         return;
     }
 
-    if (files_path.isEmpty()) {
-        fs_change changes[10] {};
-        std::uint32_t change_count{  sizeof(changes) / sizeof(fs_change) };
-        std::function<bool(const QString &)> update_adler32_backup{
-            [](const QString & mount_point)->bool
-            {
-                std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
-                if (adler32_value)
-                {
-                    bool value{ DQuickSearch::store_adler32_value(mount_point, adler32_value) };
-                    return value;
-                }
+    m_flag.store(false, std::memory_order_release);
 
-                return false;
-            }
-        };
+    fs_change changes[10] {};
+    ChangeBatch batch{ this };
 
-        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+    for (const QByteArray &path : files_path) {
+        fs_buf *buf{ batch.buffer_of(path) };
 
-        for (const QPair<QByteArray, QByteArray> &old_and_new_name : files_path) {
-            QString path_str{ QString::fromLocal8Bit(old_and_new_name.second) };
+        if (!buf) {
+            continue;
+        }
 
-            if (m_flag.load(std::memory_order_consume)) {
-                m_flag.store(false, std::memory_order_release);
-            }
+        QFileInfo file_info{ QString::fromLocal8Bit(path) };
+        int action{ ACT_NEW_FILE };
 
-            QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(path_str) };
-            std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
+        if (file_info.isSymLink()) {
+            action = ACT_NEW_SYMLINK;
+        } else if (file_info.isFile()) {
+            action = ACT_NEW_FILE;
+        } else if (file_info.isDir()) {
+            action = ACT_NEW_FOLDER;
+        } else {
+            continue;
+        }
 
-            if (pos == m_mount_point_and_lft_buf.cend()) {
-                continue;
-            }
+        if (insert_path(buf, const_cast<char *>(path.data()), action, changes) != 0) {
+            qWarning() << "failed to insert into the index:" << path;
+            batch.lose_changes();
+        }
+    }
+}
 
-            fs_buf *buf{ nullptr };
-            load_fs_buf(&buf, pos->second.toLocal8Bit().constData());
-            QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buf);
-            Q_UNUSED(sp); Q_UNUSED(raii_lock);
 
-            if (buf) {
-                rename_path(buf, const_cast<char *>(old_and_new_name.first.data()), const_cast<char *>(old_and_new_name.second.data()), changes, &change_count);
-                save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+void DQuickSearch::filesWereDeleted(const QList<QByteArray> &files_path)
+{
+    if (!m_readyFlag.load(std::memory_order_consume) || files_path.isEmpty()) {
+        return;
+    }
 
-                if (!update_adler32_backup(pos->first)) {
-                    m_mount_point_and_lft_buf.erase(pos);
-                }
-            }
+    m_flag.store(false, std::memory_order_release);
+
+    fs_change changes[10] {};
+    ChangeBatch batch{ this };
+
+    for (const QByteArray &path : files_path) {
+        fs_buf *buf{ batch.buffer_of(path) };
+
+        if (!buf) {
+            continue;
+        }
+
+        std::uint32_t change_count{  sizeof(changes) / sizeof(fs_change) };
+
+        if (remove_path(buf, const_cast<char *>(path.data()), changes, &change_count) != 0) {
+            qWarning() << "failed to remove from the index:" << path;
+            batch.lose_changes();
+        }
+    }
+}
+
+void DQuickSearch::filesWereRenamed(const QList<QPair<QByteArray, QByteArray> > &files_path)
+{
+    if (!m_readyFlag.load(std::memory_order_consume) || files_path.isEmpty()) {
+        return;
+    }
+
+    m_flag.store(false, std::memory_order_release);
+
+    fs_change changes[10] {};
+    ChangeBatch batch{ this };
+
+    for (const QPair<QByteArray, QByteArray> &old_and_new_name : files_path) {
+        fs_buf *buf{ batch.buffer_of(old_and_new_name.second) };
+
+        if (!buf) {
+            continue;
+        }
+
+        std::uint32_t change_count{  sizeof(changes) / sizeof(fs_change) };
+
+        if (rename_path(buf, const_cast<char *>(old_and_new_name.first.data()), const_cast<char *>(old_and_new_name.second.data()), changes, &change_count) != 0) {
+            qWarning() << "failed to rename in the index:" << old_and_new_name.first << old_and_new_name.second;
+            batch.lose_changes();
         }
     }
 }
@@ -694,8 +1185,12 @@ void DQuickSearch::onMountRemoved(const QString &blockDevicePath, const QByteArr
     QString mount_point{ detail::restore_escaped_char(mountPoint) };
 
     std::lock_guard<std::mutex> raii_lock{ m_mutex };
+    std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(mount_point) };
 
-    m_mount_point_and_lft_buf.erase(mount_point);
+    if (pos != m_mount_point_and_lft_buf.cend()) {
+        m_resident_indexes.erase(pos->second);
+        m_mount_point_and_lft_buf.erase(pos);
+    }
 }
 
 void DQuickSearch::onAutoInnerIndexesOpened()
@@ -1026,32 +1521,27 @@ bool DQuickSearch::create_lft(const QString &mount_point)
 {
     if (!mount_point.isEmpty()) {
         QByteArray file_located{ mount_point.toLocal8Bit() };
-        QByteArray full_path{ mount_point.toLocal8Bit() };
 
         if (file_located != QByteArray {"/"}) {
             file_located += QByteArray { "/.__deepin.lft" };
-            full_path += QByteArray { "/" };
         } else {
             file_located = QByteArray { "/.__deepin.lft" };
         }
 
-        fs_buf *buffer = new_fs_buf(buffer_size, full_path.constData());
+        fs_buf *buffer{ build_lft(mount_point, file_located) };
         QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buffer);
         Q_UNUSED(sp);
 
         if (buffer) {
-            build_fstree(buffer, 0, NULL, NULL);
-
-            if (save_fs_buf(buffer, file_located.constData()) == 0) {
-
-                ///###: adler32 check.
-                std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
-
-                if (adler32_value) {
-                    DQuickSearch::store_adler32_value(mount_point, adler32_value);
-                    m_mount_point_and_lft_buf[mount_point] = QString::fromLocal8Bit(file_located);
-                    return true;
-                }
+            ///###: adler32 check.
+            std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
+
+            if (adler32_value) {
+                DQuickSearch::store_adler32_value(mount_point, adler32_value);
+                m_mount_point_and_lft_buf[mount_point] = QString::fromLocal8Bit(file_located);
+                ///###: the tree was just built, keep it in memory rather than loading it again when searching.
+                keep_resident(m_mount_point_and_lft_buf[mount_point], sp.take());
+                return true;
             }
         }
     }
@@ -1059,6 +1549,30 @@ bool DQuickSearch::create_lft(const QString &mount_point)
     return false;
 }
 
+fs_buf *DQuickSearch::build_lft(const QString &mount_point, const QByteArray &file_path)
+{
+    QByteArray full_path{ mount_point.toLocal8Bit() };
+
+    if (full_path != QByteArray {"/"}) {
+        full_path += QByteArray { "/" };
+    }
+
+    fs_buf *buffer = new_fs_buf(buffer_size, full_path.constData());
+    QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buffer);
+
+    if (!buffer) {
+        return nullptr;
+    }
+
+    build_fstree(buffer, 0, NULL, NULL);
+
+    if (save_fs_buf(buffer, file_path.constData()) != 0) {
+        return nullptr;
+    }
+
+    return sp.take();
+}
+
 QList<QString> DQuickSearch::filter_result(const QList<QString> &searched_result, const QByteArray &regex)
 {
     QList<QString> result{};
@@ -1121,28 +1635,12 @@ std::size_t DQuickSearch::read_adler32_value(const QString &mount_point)noexcept
 
 std::size_t DQuickSearch::count_adler32(const QString &mount_point) noexcept
 {
-    std::size_t adler32_value{ 0 };
     QByteArray local8bit_mount_point{ mount_point.toLocal8Bit() + QByteArray{ "/.__deepin.lft" } };
-    std::basic_ifstream<char> file_stream{ local8bit_mount_point.constData(), std::ios_base::in | std::ios_base::binary };
-
-    if (file_stream) {
-        std::basic_ostringstream<char> string_stream{ std::ios_base::out | std::ios_base::ate };
-        std::partial_sum(std::istream_iterator<char> { file_stream }, std::istream_iterator<char> {}, std::ostream_iterator<char> {string_stream});
-        adler32_value = adler32(0L, NULL, 0);
-        std::basic_string<char> content{ string_stream.str() };
-
-        adler32_value = adler32(adler32_value, reinterpret_cast<unsigned char *>(const_cast<char *>(content.data())), content.size());
+    std::size_t adler32_value{ detail::count_adler32_of_file(local8bit_mount_point) };
 
 #ifdef QT_DEBUG
-        qDebug() << mount_point << ":  " << adler32_value;
+    qDebug() << mount_point << ":  " << adler32_value;
 #endif //QT_DEBUG
-    }
 
-    file_stream.close();
     return adler32_value;
 }
-
-
-
-
-
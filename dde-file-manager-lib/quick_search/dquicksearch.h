@@ -54,6 +54,9 @@ extern "C"
 #endif //__cplusplus
 
 #include <QObject>
+#include <QReadWriteLock>
+#include <QThreadPool>
+#include <QTimer>
 
 
 #include "durl.h"
@@ -74,6 +77,14 @@ public:
 
     QList<QString> search(const QString &local_path, const QString &key_words);
 
+    ///###: search in parallel and fetch the results page by page, the pages are in the order of the index.
+    ///###: return 0 if the search can not be started.
+    quint64 beginSearch(const QString &local_path, const QString &key_words);
+    ///###: interrupted is set when the index was changed during the search, the client should search again.
+    ///###: wait at most wait_time milliseconds for the next page, an empty page which is not finished means the results are pending.
+    QList<QString> fetchSearchResult(quint64 cursor_id, int max_count, bool *finished, bool *interrupted = nullptr, int wait_time = 0);
+    void cancelSearch(quint64 cursor_id);
+
     void filesWereCreated(const QList<QByteArray> &files_path);
     void filesWereDeleted(const QList<QByteArray> &files_path);
     void filesWereRenamed(const QList<QPair<QByteArray, QByteArray>> &files_path);
@@ -126,9 +137,44 @@ public slots:
     ///###
 
 private:
+    ///###: the fs_buf of a lft file which is kept in memory, it is only reloaded when the file was changed.
+    struct ResidentIndex {
+        std::shared_ptr<fs_buf> buf{ nullptr };
+        QReadWriteLock lock{};
+
+        std::uint64_t inode{ 0 };
+        std::int64_t size{ 0 };
+        std::int64_t mtime_ns{ 0 };
+
+        ///###: the name offsets where the shards of a parallel search can begin.
+        std::vector<std::uint32_t> shard_offs{};
+        ///###: the offsets of names are moved by the changes, recount them before the next search.
+        std::atomic<bool> shard_offs_dirty{ false };
+        ///###: a change could not be applied, the index is built again instead of being saved.
+        std::atomic<bool> changes_lost{ false };
+
+        ///###: increased by every batch of changes applied in memory.
+        std::atomic<std::uint64_t> generation{ 0 };
+        ///###: the generation which was saved to the lft file, protected by m_mutex.
+        std::uint64_t saved_generation{ 0 };
+    };
+
+    struct SearchCursor;
+    class ChangeBatch;
+
+    std::shared_ptr<ResidentIndex> resident_index(const QString &mount_point, const QString &lft_file);
+    std::shared_ptr<ResidentIndex> index_of_path(const QString &local_path);
+    void keep_resident(const QString &lft_file, fs_buf *buf);
+    std::shared_ptr<ResidentIndex> index_of_changed_path(const QByteArray &path);
+    void save_resident_indexes();
+    static void count_shard_offs(ResidentIndex *index);
+    static void search_shard(const std::shared_ptr<SearchCursor> &cursor, std::size_t shard);
+
     void cache_every_partion();
     void initialize_connection()noexcept;
     bool create_lft(const QString &mount_point);
+    ///###: build the tree of a partition and save it to file_path, m_mutex is not needed.
+    static fs_buf *build_lft(const QString &mount_point, const QByteArray &file_path);
 
     ///###: it is standby.
     static QList<QString> filter_result(const QList<QString> &searched_result, const QByteArray &regex);
@@ -140,6 +186,16 @@ private:
     std::atomic<bool> m_flag{ false };
     std::deque<QString> m_backup{};
     std::map<QString, QString> m_mount_point_and_lft_buf{};
+    std::map<QString, std::shared_ptr<ResidentIndex>> m_resident_indexes{};
+
+    std::mutex m_cursor_mutex{};
+    std::map<quint64, std::shared_ptr<SearchCursor>> m_cursors{};
+    quint64 m_last_cursor_id{ 0 };
+    QThreadPool m_search_pool{};
+
+    ///###: the changes are applied in memory at once and saved to the lft files later.
+    QTimer m_save_timer{};
+    std::atomic<bool> m_saving{ false };
 
     std::basic_regex<char> m_wildcard_char{};
 
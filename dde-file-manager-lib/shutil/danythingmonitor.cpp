@@ -95,8 +95,10 @@ void DAnythingMonitor::doWork()
     if (!m_changedFiles.empty()) {
         std::deque<std::pair<QString, QString>>::const_iterator cbeg{ m_changedFiles.cbegin() };
         std::deque<std::pair<QString, QString>>::const_iterator cend{ m_changedFiles.cend() };
+        QList<DUrl> deletedFiles{};
+        QList<QPair<QByteArray, QByteArray>> renamedFiles{};
 
-
+        ///###: the continuous deletings or renamings are synchronized with sqlite in one call.
         for (; cbeg != cend; ++cbeg) {
 
             if (cbeg->first.isEmpty()) {
@@ -104,7 +106,12 @@ void DAnythingMonitor::doWork()
 #ifdef QT_DEBUG
                 qDebug() << cbeg->second;
 #endif
-                TagManager::instance()->deleteFiles({DUrl::fromLocalFile(cbeg->second)});
+                if (!renamedFiles.isEmpty()) {
+                    TagManager::instance()->changeFilesName(renamedFiles);
+                    renamedFiles.clear();
+                }
+
+                deletedFiles.push_back(DUrl::fromLocalFile(cbeg->second));
 
                 continue;
             }
@@ -115,7 +122,31 @@ void DAnythingMonitor::doWork()
             qDebug() << oldAndNewFileName;
 #endif
 
-            TagManager::instance()->changeFilesName({ oldAndNewFileName });
+            if (!deletedFiles.isEmpty()) {
+                TagManager::instance()->deleteFiles(deletedFiles);
+                deletedFiles.clear();
+            }
+
+            ///###: the old names are the keys of a map when renaming, and the order of the map is not the order of renaming.
+            for (const QPair<QByteArray, QByteArray> &renamed : renamedFiles) {
+
+                if (renamed.first == oldAndNewFileName.first || renamed.second == oldAndNewFileName.first) {
+                    TagManager::instance()->changeFilesName(renamedFiles);
+                    renamedFiles.clear();
+
+                    break;
+                }
+            }
+
+            renamedFiles.push_back(oldAndNewFileName);
+        }
+
+        if (!deletedFiles.isEmpty()) {
+            TagManager::instance()->deleteFiles(deletedFiles);
+        }
+
+        if (!renamedFiles.isEmpty()) {
+            TagManager::instance()->changeFilesName(renamedFiles);
         }
 
         m_changedFiles.clear();
@@ -138,6 +138,37 @@ static constexpr const std::size_t MAXTHREAD{ 3 };
 static constexpr const char *const CONNECTIONNAME{ "deep" };
 static constexpr const char *const USERNAME{"username"};
 static constexpr const char *const PASSWORD{"password"};
+static constexpr const char *const CREATEINDEXES[]{
+    "CREATE INDEX IF NOT EXISTS tag_with_file_file_name ON tag_with_file (file_name)",
+    "CREATE INDEX IF NOT EXISTS tag_with_file_tag_name ON tag_with_file (tag_name)"
+};
+
+///###: these statements are prepared once and executed with bound values.
+static constexpr const char *const SQLFORDELETINGTAGOFFILE{
+    "DELETE FROM tag_with_file WHERE tag_with_file.tag_name = :tag_name "
+    "AND tag_with_file.file_name = :file_name"
+};
+static constexpr const char *const SQLFORINSERTINGTAGOFFILE{
+    "INSERT INTO tag_with_file (file_name, tag_name) VALUES (:file_name, :tag_name)"
+};
+static constexpr const char *const SQLFORGETTINGTAGSOFFILE{
+    "SELECT tag_with_file.tag_name FROM tag_with_file WHERE tag_with_file.file_name = :file_name"
+};
+static constexpr const char *const SQLFORDELETINGFILEPROPERTY{
+    "DELETE FROM file_property WHERE file_property.file_name = :file_name"
+};
+static constexpr const char *const SQLFORCOUNTINGFILEPROPERTY{
+    "SELECT COUNT (file_property.file_name) AS counter FROM file_property "
+    "WHERE file_property.file_name = :file_name"
+};
+static constexpr const char *const SQLFORUPDATINGFILEPROPERTY{
+    "UPDATE file_property SET tag_1 = :tag_1, tag_2 = :tag_2, tag_3 = :tag_3 "
+    "WHERE file_property.file_name = :file_name"
+};
+static constexpr const char *const SQLFORINSERTINGFILEPROPERTY{
+    "INSERT INTO file_property (file_name, tag_1, tag_2, tag_3) "
+    "VALUES(:file_name, :tag_1, :tag_2, :tag_3)"
+};
 
 
 static const std::map<QString, QString> StrTableOfEscapeChar{
@@ -288,6 +319,10 @@ static const std::multimap<DSqliteHandle::SqlType, QString> SqlTypeWithStrs {
         DSqliteHandle::SqlType::GetTagsThroughFile, "SELECT tag_with_file.tag_name FROM tag_with_file "
         "WHERE tag_with_file.file_name = \'%1\'"
     },
+    {
+        DSqliteHandle::SqlType::GetTagsOfFiles, "SELECT tag_with_file.file_name, tag_with_file.tag_name FROM tag_with_file "
+        "WHERE tag_with_file.file_name IN (%1)"
+    },
     {
         DSqliteHandle::SqlType::GetFilesThroughTag, "SELECT tag_with_file.file_name FROM tag_with_file "
         "WHERE tag_with_file.tag_name = \'%1\'"
@@ -510,6 +545,8 @@ void DSqliteHandle::onMountRemoved(UDiskDeviceInfoPointer infoPointer)
 
     m_flag.store(true, std::memory_order_release);
     std::lock_guard<std::mutex> raiiLock{ m_mutex };
+    ///###: do not keep the removed device busy, the connections will be opened again when using.
+    this->closeAllSqlDatabases();
     std::map<QString, std::multimap<QString, QString>> partionsAndMountPoints{ DSqliteHandle::queryPartionsInfoOfDevices() };
     m_partionsOfDevices.reset(nullptr);
 
@@ -655,6 +692,13 @@ QVariant DSqliteHandle::disposeClientData(const QMap<QString, QList<QString>> &f
 
             break;
         }
+        case 14: {
+            std::lock_guard<std::mutex> raii_lock{ m_mutex };
+            QMap<QString, QVariant> file_and_tags{ this->execSqlstr<DSqliteHandle::SqlType::GetTagsOfFiles, QMap<QString, QVariant>>(filesAndTags) };
+            var.setValue(file_and_tags);
+
+            break;
+        }
         default:
             break;
         }
@@ -693,33 +737,31 @@ void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db
 {
     DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint, db_name) };
     std::function<void()> initDatabasePtr{ [&]{
+            QString DBName{mountPoint + QString{"/"} + db_name};
+            std::map<QString, QSqlDatabase>::iterator itr{ m_sqlDatabases.find(DBName) };
 
-            if (m_sqlDatabasePtr->isOpen())
-            {
-                m_sqlDatabasePtr->close();
-            }
-
-            if (QSqlDatabase::contains(CONNECTIONNAME))
-            {
-                m_sqlDatabasePtr.reset(nullptr);
-                QSqlDatabase::removeDatabase(CONNECTIONNAME);
+            ///###: the database file was removed, the old connection is useless.
+            if (itr != m_sqlDatabases.end() && code == DSqliteHandle::ReturnCode::NoExist) {
+                m_preparedSqlQueries.erase(DBName);
+                itr->second.close();
             }
 
-            m_sqlDatabasePtr = std::unique_ptr<QSqlDatabase>{new QSqlDatabase{ QSqlDatabase::addDatabase(R"foo(QSQLITE)foo", CONNECTIONNAME)} };
-            QString DBName{mountPoint + QString{"/"} + db_name};
+            if (itr == m_sqlDatabases.end()) {
+                QSqlDatabase sqlDatabase{ QSqlDatabase::addDatabase(R"foo(QSQLITE)foo", QString{CONNECTIONNAME} + DBName) };
 
-            ///###: for debugging.
-//            qDebug() << DBName;
+                sqlDatabase.setDatabaseName(DBName);
+                sqlDatabase.setUserName(USERNAME);
+                sqlDatabase.setPassword(PASSWORD);
+                itr = m_sqlDatabases.insert(std::make_pair(DBName, sqlDatabase)).first;
+            }
 
-            m_sqlDatabasePtr->setDatabaseName(DBName);
-            m_sqlDatabasePtr->setUserName(USERNAME);
-            m_sqlDatabasePtr->setPassword(PASSWORD);
+            m_sqlDatabasePtr = &itr->second;
         } };
 
     if (code == DSqliteHandle::ReturnCode::NoExist) {
         initDatabasePtr();
 
-        if (m_sqlDatabasePtr->open()) {
+        if (this->openSqlDatabase()) {
 
             if (m_sqlDatabasePtr->transaction()) {
                 QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
@@ -753,6 +795,13 @@ void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db
                             qWarning() << sqlQuery.lastError().text();
                         }
 
+                        for (const char *const createIndex : CREATEINDEXES) {
+
+                            if (!sqlQuery.exec(createIndex)) {
+                                qWarning() << sqlQuery.lastError().text();
+                            }
+                        }
+
                     } else {
                         DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
 
@@ -765,6 +814,13 @@ void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db
                             if (!sqlQuery.exec(createTagWithFile)) {
                                 qWarning() << sqlQuery.lastError().text();
                             }
+
+                            for (const char *const createIndex : CREATEINDEXES) {
+
+                                if (!sqlQuery.exec(createIndex)) {
+                                    qWarning() << sqlQuery.lastError().text();
+                                }
+                            }
                         }
                     }
 
@@ -803,6 +859,7 @@ void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db
 
             } else {
                 qWarning() << "failed to open transaction!!!!!!";
+                m_preparedSqlQueries.erase(m_sqlDatabasePtr->databaseName());
                 m_sqlDatabasePtr->close();
             }
 
@@ -817,6 +874,67 @@ void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db
     this->closeSqlDatabase();
 }
 
+bool DSqliteHandle::openSqlDatabase()
+{
+    if (!m_sqlDatabasePtr) {
+        return false;
+    }
+
+    if (m_sqlDatabasePtr->isOpen()) {
+        return true;
+    }
+
+    if (!m_sqlDatabasePtr->open()) {
+        return false;
+    }
+
+    m_preparedSqlQueries.erase(m_sqlDatabasePtr->databaseName());
+    QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+
+    ///###: in WAL mode readers do not block the writer, and a commit does not need to sync the database file.
+    for (const char *const pragma : { "PRAGMA journal_mode = WAL", "PRAGMA synchronous = NORMAL" }) {
+
+        if (!sqlQuery.exec(pragma)) {
+            qWarning() << sqlQuery.lastError().text();
+        }
+    }
+
+    ///###: for the databases which were created by old version.
+    ///###: it fails when the table has not been created, and the indexes will be created with the table.
+    for (const char *const createIndex : CREATEINDEXES) {
+        sqlQuery.exec(createIndex);
+    }
+
+    return true;
+}
+
+///###: this is a auxiliary function. so do not need a mutex.
+void DSqliteHandle::closeAllSqlDatabases()
+{
+    m_preparedSqlQueries.clear();
+
+    for (std::pair<const QString, QSqlDatabase> &database : m_sqlDatabases) {
+        database.second.close();
+    }
+}
+
+///###: the query is prepared once for each connection, bind the values and exec it.
+QSqlQuery &DSqliteHandle::preparedSqlQuery(const QString &sqlStr)
+{
+    std::map<QString, QSqlQuery> &sqlQueries{ m_preparedSqlQueries[m_sqlDatabasePtr->databaseName()] };
+    std::map<QString, QSqlQuery>::iterator itr{ sqlQueries.find(sqlStr) };
+
+    if (itr == sqlQueries.end()) {
+        itr = sqlQueries.insert(std::make_pair(sqlStr, QSqlQuery{ *m_sqlDatabasePtr })).first;
+
+        if (!itr->second.prepare(sqlStr)) {
+            qWarning() << itr->second.lastError().text();
+        }
+    }
+
+    return itr->second;
+}
+
 
 ///###:this is also a auxiliary function. do not need a mutex.
 template<>
@@ -826,42 +944,24 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles, QMap<QString,
     if (!forDecreasing.isEmpty() && !mountPoint.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ forDecreasing.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ forDecreasing.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr; ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
+        QSqlQuery &sqlQuery{ this->preparedSqlQuery(SQLFORDELETINGTAGOFFILE) };
 
         for (; cbeg != cend; ++cbeg) {
 
             for (const QString &tagName : cbeg.value()) {
-                QString sql{ itr->second.arg(tagName) };
-                sql = sql.arg(cbeg.key());
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    ///###: delete redundant item in tag_with_file.
-                    if (!sqlQuery.exec(sql)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
-
-                    DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
 
-                        if (!sqlQuery.exec(sql)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+                if (m_flag.load(std::memory_order_acquire)
+                        && this->checkWhetherHasSqliteInPartion(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+                    return false;
+                }
 
-                    } else {
+                sqlQuery.bindValue(":tag_name", tagName);
+                sqlQuery.bindValue(":file_name", cbeg.key());
 
-                        return false;
-                    }
+                ///###: delete redundant item in tag_with_file.
+                if (!sqlQuery.exec()) {
+                    qWarning() << sqlQuery.lastError().text();
+                    continue;
                 }
             }
         }
@@ -880,41 +980,24 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString,
     if (!forIncreasing.isEmpty() && !mountPoint.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ forIncreasing.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ forIncreasing.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+        QSqlQuery &sqlQuery{ this->preparedSqlQuery(SQLFORINSERTINGTAGOFFILE) };
 
         for (; cbeg != cend; ++cbeg) {
 
             for (const QString &tagName : cbeg.value()) {
-                QString sql{ itr->second.arg(cbeg.key()) };
-                sql = sql.arg(tagName);
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    ///###: tag files
-                    if (!sqlQuery.exec(sql)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
-
-                    DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
 
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                        if (!sqlQuery.exec(sql)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+                if (m_flag.load(std::memory_order_acquire)
+                        && this->checkWhetherHasSqliteInPartion(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+                    return false;
+                }
 
-                    } else {
+                sqlQuery.bindValue(":file_name", cbeg.key());
+                sqlQuery.bindValue(":tag_name", tagName);
 
-                        return false;
-                    }
+                ///###: tag files
+                if (!sqlQuery.exec()) {
+                    qWarning() << sqlQuery.lastError().text();
+                    continue;
                 }
             }
         }
@@ -934,105 +1017,52 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString
     if (!forUpdating.isEmpty() && !mountPoint.isEmpty()) {
         QList<QString>::const_iterator cbeg{ forUpdating.cbegin() };
         QList<QString>::const_iterator cend{ forUpdating.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr; ++itr; ++itr; ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+        QSqlQuery &sqlForGettingTags{ this->preparedSqlQuery(SQLFORGETTINGTAGSOFFILE) };
+        QSqlQuery &sqlForDelRowInFileProperty{ this->preparedSqlQuery(SQLFORDELETINGFILEPROPERTY) };
+        QSqlQuery &sqlOfCountingFileInFP{ this->preparedSqlQuery(SQLFORCOUNTINGFILEPROPERTY) };
+        QSqlQuery &sqlForUpdatingFileProperty{ this->preparedSqlQuery(SQLFORUPDATINGFILEPROPERTY) };
+        QSqlQuery &sqlForInsertRowInFP{ this->preparedSqlQuery(SQLFORINSERTINGFILEPROPERTY) };
 
         for (; cbeg != cend; ++cbeg) {
-            QString sqlForGettingTag{ itr->second.arg(*cbeg) };
-            std::vector<QString> leftTags{};
-
-            if (!m_flag.load(std::memory_order_acquire)) {
 
-                if (sqlQuery.exec(sqlForGettingTag)) {
-
-                    while (sqlQuery.next()) {
-                        QString tagName{ sqlQuery.value("tag_name").toString() };
-                        leftTags.push_back(tagName);
-                    }
-                }
-
-            } else {
-
-                DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
+            if (m_flag.load(std::memory_order_acquire)
+                    && this->checkWhetherHasSqliteInPartion(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+                return false;
+            }
 
-                if (code == DSqliteHandle::ReturnCode::Exist) {
+            std::vector<QString> leftTags{};
+            sqlForGettingTags.bindValue(":file_name", *cbeg);
 
-                    if (sqlQuery.exec(sqlForGettingTag)) {
+            if (sqlForGettingTags.exec()) {
 
-                        while (sqlQuery.next()) {
-                            QString tagName{ sqlQuery.value("tag_name").toString() };
-                            leftTags.push_back(tagName);
-                        }
-                    }
-
-                } else {
-                    return false;
+                while (sqlForGettingTags.next()) {
+                    QString tagName{ sqlForGettingTags.value("tag_name").toString() };
+                    leftTags.push_back(tagName);
                 }
             }
 
-            if (leftTags.empty()) {
-                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForDelRowInFileProperty{itr};
-                --itrForDelRowInFileProperty;
-                QString sqlForDelRowInFileProperty{ itrForDelRowInFileProperty->second.arg(*cbeg) };
-
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    if (!sqlQuery.exec(sqlForDelRowInFileProperty)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
-
-                    DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
+            sqlForGettingTags.finish();
 
-                        if (!sqlQuery.exec(sqlForDelRowInFileProperty)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+            if (leftTags.empty()) {
+                sqlForDelRowInFileProperty.bindValue(":file_name", *cbeg);
 
-                    } else {
-                        return false;
-                    }
+                if (!sqlForDelRowInFileProperty.exec()) {
+                    qWarning() << sqlForDelRowInFileProperty.lastError().text();
+                    continue;
                 }
 
             } else {
-
-                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForCounterFileInFP{ itr };
-                ++itrForCounterFileInFP; ++itrForCounterFileInFP;
-                QString sqlOfCountingFileInFP{ itrForCounterFileInFP->second.arg(*cbeg) };
-
                 int counter{ 0 };
+                sqlOfCountingFileInFP.bindValue(":file_name", *cbeg);
 
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    if (sqlQuery.exec(sqlOfCountingFileInFP)) {
+                if (sqlOfCountingFileInFP.exec()) {
 
-                        if (sqlQuery.next()) {
-                            counter =  sqlQuery.value("counter").toInt();
-                        }
-                    }
-
-                } else {
-                    DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                        if (sqlQuery.exec(sqlOfCountingFileInFP)) {
-                            counter = sqlQuery.value("counter").toInt();
-                        }
-
-                    } else {
-                        return false;
+                    if (sqlOfCountingFileInFP.next()) {
+                        counter =  sqlOfCountingFileInFP.value("counter").toInt();
                     }
                 }
 
+                sqlOfCountingFileInFP.finish();
                 std::size_t size{ leftTags.size() };
 
                 if (size < 3) {
@@ -1043,77 +1073,17 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString
                     }
                 }
 
+                std::size_t sizeOfTags{ leftTags.size() };
+                QSqlQuery &sqlForWritingFileProperty{ counter > 0 ? sqlForUpdatingFileProperty : sqlForInsertRowInFP };
 
-                if (counter > 0) {
-                    std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForUpdating{itr};
-                    ++itrForUpdating;
-
-                    std::size_t sizeOfTags{ leftTags.size() };
-
-                    QString sqlForUpdatingFileProperty{itrForUpdating->second.arg(leftTags[sizeOfTags - 3])};
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(leftTags[sizeOfTags - 2]);
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(leftTags[sizeOfTags - 1]);
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(*cbeg);
-
-                    if (!m_flag.load(std::memory_order_acquire)) {
-
-                        if (!sqlQuery.exec(sqlForUpdatingFileProperty)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
-
-                    } else {
-
-                        DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
-
-                        if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                            if (!sqlQuery.exec(sqlForUpdatingFileProperty)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
-
-                        } else {
-                            return false;
-                        }
-
-                    }
-
-                } else {
+                sqlForWritingFileProperty.bindValue(":file_name", *cbeg);
+                sqlForWritingFileProperty.bindValue(":tag_1", leftTags[sizeOfTags - 3]);
+                sqlForWritingFileProperty.bindValue(":tag_2", leftTags[sizeOfTags - 2]);
+                sqlForWritingFileProperty.bindValue(":tag_3", leftTags[sizeOfTags - 1]);
 
-                    std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForInsertRowInFP{ itr };
-                    ++itrForInsertRowInFP;
-                    ++itrForInsertRowInFP;
-                    ++itrForInsertRowInFP;
-                    std::size_t sizeOfTags{ leftTags.size() };
-                    QString sqlForInsertRowInFP{ itrForInsertRowInFP->second.arg(*cbeg) };
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 3]);
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 2]);
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 1]);
-
-
-                    if (!m_flag.load(std::memory_order_acquire)) {
-
-                        if (!sqlQuery.exec(sqlForInsertRowInFP)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
-
-                    } else {
-
-                        DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
-
-                        if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                            if (!sqlQuery.exec(sqlForInsertRowInFP)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
-
-                        } else {
-                            return false;
-                        }
-                    }
+                if (!sqlForWritingFileProperty.exec()) {
+                    qWarning() << sqlForWritingFileProperty.lastError().text();
+                    continue;
                 }
             }
         }
@@ -2312,7 +2282,7 @@ QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType:
                     if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                         this->connectToSqlite(partion_itr_beg->second);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                        if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                             QSqlQuery sql_query{ *m_sqlDatabasePtr };
 
                             for (const QString &tag_name : tag_names) {
@@ -2442,7 +2412,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFiles, bool>(const QMa
                     }
                 }
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                     bool valueOfDelRedundant{ true };
 
                     if (!decreased.isEmpty()) {
@@ -2535,7 +2505,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFiles, bool>(const QMa
             if (code == DSqliteHandle::ReturnCode::Exist || code == DSqliteHandle::ReturnCode::NoExist) {
                 this->connectToSqlite(unixDeviceAndMountPoint.second);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
                     bool valueOfInsertNew{ true };
                     valueOfInsertNew = this->helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>,
@@ -2595,7 +2565,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFilesThroughColor, boo
         this->connectToSqlite("/home", ".__main.db");
         bool the_result{ true };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, QString, bool>(filesAndTags.cbegin().key(), "/home");
         }
 
@@ -2674,7 +2644,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFilesThroughColor, boo
                     if (!sqlStrs.empty()) {
                         bool value{ false };
 
-                        if (m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                             value = this->helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor,
                             std::list<std::tuple<QString, QString, QString, QString, QString, QString>>, bool>(sqlStrs, cbeg.key());
 
@@ -2765,7 +2735,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::UntagSamePartionFiles, bo
                         }
                     }
 
-                    if (!sqlForDeletingRowOfTagWithFile.empty() && m_sqlDatabasePtr->open()
+                    if (!sqlForDeletingRowOfTagWithFile.empty() && this->openSqlDatabase()
                             && m_sqlDatabasePtr->transaction()) {
                         bool resultOfDeleteRowInTagWithFile{ this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
                                                              std::list<QString>, bool>(sqlForDeletingRowOfTagWithFile, unixDeviceAndMountPoint.second) };
@@ -2904,7 +2874,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToSqlite(itr_partion_and_files->first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                     QMap<QString, QList<QString>> file_and_tags_partion{
                         this->helpExecSql<DSqliteHandle::SqlType::DeleteFiles2,
                         std::list<QString>, QMap<QString, QList<QString>>>(itr_partion_and_files->second, itr_partion_and_files->first)
@@ -2939,7 +2909,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToSqlite(itr_partion_and_files->first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
                     bool result{ this->helpExecSql<DSqliteHandle::SqlType::DeleteFiles,
                                  std::list<QString>, bool>(itr_partion_and_files->second, itr_partion_and_files->first) };
@@ -2989,7 +2959,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteTags, bool>(const Q
         bool the_result{ true };
         QList<QString> the_tags_for_deleting{ filesAndTags.keys() };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::DeleteTags3, QList<QString>, bool>(the_tags_for_deleting, "/home");
         }
 
@@ -3039,7 +3009,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteTags, bool>(const Q
                             bool flagForDeleteInTagWithFile{ false };
                             bool flagForUpdatingFileProperty{ false };
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                            if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                                 flagForDeleteInTagWithFile = this->helpExecSql<DSqliteHandle::SqlType::DeleteTags,
                                 std::list<QString>, bool>(sqlStrs, mountPointItr->second);
 
@@ -3116,7 +3086,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToSqlite(partion_and_file_names.first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                     QMap<QString, QList<QString>> file_with_tags{
                         this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
                         QMap<QString, QList<QString>>>(partion_and_file_names.second, partion_and_file_names.first)
@@ -3165,7 +3135,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
                     if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                         this->connectToSqlite(mountPointAndSqls.first);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                             bool resultOfExecSql{ this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName,
                                                   std::map<QString, QString>, bool>(mountPointAndSqls.second, mountPointAndSqls.first) };
 
@@ -3196,7 +3166,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
                     if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                         this->connectToSqlite(mount_point_and_file_names.first);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                        if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                             QMap<QString, QList<QString>> file_with_tags{
                                 this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
                                 QMap<QString, QList<QString>>>(new_and_old_names, mount_point_and_file_names.first)
@@ -3262,7 +3232,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagsName, bool>(con
         this->connectToSqlite("/home", ".__main.db");
         bool the_result{ true };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::ChangeTagsName2, QMap<QString, QList<QString>>, bool>(filesAndTags, "/home");
         }
 
@@ -3313,7 +3283,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagsName, bool>(con
                             bool resultOfChangeNameOfTag{ true };
                             bool flagOfTransaction{ true };
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                            if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                                 flagOfTransaction = m_sqlDatabasePtr->transaction();
 
                                 if (flagOfTransaction) {
@@ -3383,7 +3353,7 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
             this->connectToSqlite(partionAndMountPoint.second);
 
             ///###: no transaction.
-            if (m_sqlDatabasePtr->open()) {
+            if (this->openSqlDatabase()) {
                 tags = this->helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile,
                 QString, QList<QString>>(sqlForGetTagsThroughFile, partionAndMountPoint.second);
             }
@@ -3400,6 +3370,84 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
     return tags_backup;
 }
 
+///###: <file, [tag-name(s)]>, files in the same partion are queried with one sql statement.
+template<>
+QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsOfFiles, QMap<QString, QVariant>>(const QMap<QString, QList<QString>> &filesAndTags)
+{
+    QMap<QString, QVariant> file_and_tags{};
+    std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
+        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagsOfFiles) };
+    ///###: <mount-point, <file(removed mount point), file>>
+    QMap<QString, QMap<QString, QString>> files_of_partions{};
+    ///###: the files requested together are usually in the same directory.
+    QMap<QString, QString> mount_point_of_dirs{};
+
+    for (auto cbeg = filesAndTags.cbegin(); cbeg != filesAndTags.cend(); ++cbeg) {
+        const DUrl &url{ DUrl::fromLocalFile(cbeg.key()) };
+        const QString &dir{ url.parentUrl().path() };
+        auto mount_point = mount_point_of_dirs.constFind(dir);
+
+        if (mount_point == mount_point_of_dirs.cend()) {
+            mount_point = mount_point_of_dirs.insert(dir, DSqliteHandle::getMountPointOfFile(url, m_partionsOfDevices).second);
+        }
+
+        if (mount_point.value().isEmpty()) {
+            continue;
+        }
+
+        files_of_partions[mount_point.value()][this->remove_mount_point(cbeg.key(), mount_point.value())] = cbeg.key();
+    }
+
+    for (auto partion = files_of_partions.cbegin(); partion != files_of_partions.cend(); ++partion) {
+        DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(partion.key()) };
+
+        if (code != DSqliteHandle::ReturnCode::Exist) {
+            continue;
+        }
+
+        this->connectToSqlite(partion.key());
+
+        if (!this->openSqlDatabase()) {
+            continue;
+        }
+
+        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+        QStringList names{};
+
+        for (auto file = partion.value().cbegin(); file != partion.value().cend(); ++file) {
+            names.push_back(QString{"\'%1\'"}.arg(file.key()));
+
+            if (names.size() < 500 && std::next(file) != partion.value().cend()) {
+                continue;
+            }
+
+            ///###: no transaction.
+            if (!sqlQuery.exec(range.first->second.arg(names.join(",")))) {
+                qWarning() << sqlQuery.lastError().text();
+            }
+
+            while (sqlQuery.next()) {
+                const QString &file_name{ partion.value().value(sqlQuery.value("file_name").toString()) };
+
+                if (file_name.isEmpty()) {
+                    continue;
+                }
+
+                QStringList tags{ file_and_tags.value(Tag::restore_escaped_en_skim(file_name)).toStringList() };
+
+                tags.push_back(Tag::restore_escaped_en_skim(sqlQuery.value("tag_name").toString()));
+                file_and_tags[Tag::restore_escaped_en_skim(file_name)] = tags;
+            }
+
+            names.clear();
+        }
+
+        this->closeSqlDatabase();
+    }
+
+    return file_and_tags;
+}
+
 template<>
 QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThroughTag, QList<QString>>(const QMap<QString, QList<QString>> &filesAndTags)
 {
@@ -3428,7 +3476,7 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThrough
                         if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                             this->connectToSqlite(mountPointItr->second);
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                            if (m_sqlDatabasePtr && this->openSqlDatabase()) {
 
                                 QList<QString> filesOfPartion{ this->helpExecSql<DSqliteHandle::SqlType::GetFilesThroughTag,
                                                                QString, QList<QString>>(sqlForGetFilesThroughTag, mountPointItr->second) };
@@ -3510,7 +3558,7 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetAll
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetAllTags) };
         this->connectToSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase()) {
             QSqlQuery sql_query{ *m_sqlDatabasePtr };
 
             if (sql_query.exec(range.first->second)) {
@@ -3542,7 +3590,7 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTag
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagColor) };
         this->connectToSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase()) {
             QMap<QString, QList<QString>>::const_iterator c_beg{ fileAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ fileAndTags.cend() };
             QString sql_str{ range.first->second };
@@ -3575,7 +3623,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagColor, bool>(con
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::ChangeTagColor) };
         this->connectToSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             QMap<QString, QList<QString>>::const_iterator c_beg{ filesAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ filesAndTags.cend() };
             QSqlQuery sql_query{ *m_sqlDatabasePtr };
@@ -3617,7 +3665,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::BeforeTagFiles, bool>(con
         this->connectToSqlite("/home", ".__main.db");
 
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
             QMap<QString, QList<QString>>::const_iterator c_beg{ filesAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ filesAndTags.cend() };
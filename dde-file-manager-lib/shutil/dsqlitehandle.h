@@ -77,6 +77,7 @@ public:
 
         GetTagsThroughFile,
         GetSameTagsOfDiffFiles,
+        GetTagsOfFiles,
 
         UntagDiffPartionFiles,
 
@@ -124,13 +125,16 @@ private slots:
 private:
     static QString restoreEscapedChar(const QString& value);
 
+    ///###: the connection of every partion is kept open until the partion is unmounted.
+    ///###: so there is nothing need to do when finishing a operation.
     inline void closeSqlDatabase()noexcept
     {
-        if(m_sqlDatabasePtr && m_sqlDatabasePtr->isOpen()){
-            m_sqlDatabasePtr->close();
-        }
     }
 
+    bool openSqlDatabase();
+    void closeAllSqlDatabases();
+    QSqlQuery& preparedSqlQuery(const QString& sqlStr);
+
     inline QString remove_mount_point(const QString& file, const QString& mount_point) noexcept
     {
         int index{ file.indexOf(mount_point) };
@@ -166,7 +170,11 @@ private:
     void connectToSqlite(const QString& mountPoint, const QString& db_name = QString{".__deepin.db"});
 
     std::unique_ptr<std::map<QString, std::multimap<QString, QString>>> m_partionsOfDevices{ nullptr };
-    std::unique_ptr<QSqlDatabase> m_sqlDatabasePtr{ nullptr };
+    QSqlDatabase* m_sqlDatabasePtr{ nullptr };
+    ///###: <database name, connection>
+    std::map<QString, QSqlDatabase> m_sqlDatabases{};
+    ///###: <database name, <sql, prepared query>>
+    std::map<QString, std::map<QString, QSqlQuery>> m_preparedSqlQueries{};
     std::atomic<bool> m_flag{ false };
     std::mutex m_mutex{};
 
@@ -194,6 +202,9 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
 template<>
 QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetSameTagsOfDiffFiles, QList<QString>>(const QMap<QString, QList<QString>>& filesAndTags);
 
+template<>
+QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsOfFiles, QMap<QString, QVariant>>(const QMap<QString, QList<QString>>& filesAndTags);
+
 template<>
 QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThroughTag, QList<QString>>(const QMap<QString, QList<QString>>& filesAndTags);
 
@@ -88,6 +88,30 @@ QList<QString> TagManager::getTagsThroughFiles(const QList<DUrl> &files)
     return QList<QString> {};
 }
 
+QHash<DUrl, QList<QString>> TagManager::getTagsOfFiles(const QList<DUrl> &files)
+{
+    QHash<DUrl, QList<QString>> file_and_tags{};
+
+    if (!files.isEmpty()) {
+        QMap<QString, QVariant> string_var{};
+
+        for (const DUrl &url : files) {
+            string_var[url.toLocalFile()] = QVariant{ QList<QString>{} };
+        }
+
+        QVariant var{ TagManagerDaemonController::instance()->disposeClientData(string_var, Tag::ActionType::GetTagsOfFiles) };
+        string_var = var.toMap();
+        QMap<QString, QVariant>::const_iterator c_beg{ string_var.cbegin() };
+        QMap<QString, QVariant>::const_iterator c_end{ string_var.cend() };
+
+        for (; c_beg != c_end; ++c_beg) {
+            file_and_tags[DUrl::fromLocalFile(c_beg.key())] = c_beg.value().toStringList();
+        }
+    }
+
+    return file_and_tags;
+}
+
 QMap<QString, QColor> TagManager::getTagColor(const QList<QString> &tags) const
 {
     QMap<QString, QColor> tag_and_color{};
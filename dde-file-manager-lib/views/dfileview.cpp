@@ -71,6 +71,8 @@
 #include <QMimeData>
 #include <QScrollBar>
 #include <QScroller>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 
 #include <private/qguiapplication_p.h>
 #include <qpa/qplatformtheme.h>
@@ -138,7 +140,8 @@ public:
     DUrlList oldSelectedUrls;
     DUrl oldCurrentUrl;
 
-    DFileView::RandeIndex visibleIndexRande;
+    // 当前处于激活状态（可见）的文件
+    QSet<DUrl> activeUrls;
 
     /// menu actions filter
     QSet<MenuAction> menuWhitelist;
@@ -149,6 +152,8 @@ public:
     FileViewHelper *fileViewHelper;
 
     QTimer* updateStatusBarTimer;
+    // 滚动时合并更新激活的文件，每帧最多更新一次
+    QTimer* updateActiveIndexTimer;
 
     QScrollBar* verticalScrollBar = NULL;
 
@@ -203,6 +208,13 @@ DFileView::DFileView(QWidget *parent)
     d->updateStatusBarTimer->setInterval(100);
     d->updateStatusBarTimer->setSingleShot(true);
     connect(d->updateStatusBarTimer, &QTimer::timeout, this, &DFileView::updateStatusBar);
+
+    d->updateActiveIndexTimer = new QTimer(this);
+    d->updateActiveIndexTimer->setInterval(16);
+    d->updateActiveIndexTimer->setSingleShot(true);
+    connect(d->updateActiveIndexTimer, &QTimer::timeout, this, &DFileView::updateModelActiveIndex);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged,
+            d->updateActiveIndexTimer, static_cast<void(QTimer::*)()>(&QTimer::start));
 }
 
 DFileView::~DFileView()
@@ -1196,43 +1208,98 @@ void DFileView::updateModelActiveIndex()
 
     const RandeIndex &rande = randeList.first();
     DAbstractFileWatcher *fileWatcher = model()->fileWatcher();
+    QSet<DUrl> visibleUrls;
+    QList<DAbstractFileInfoPointer> newVisibleInfos;
+
+    visibleUrls.reserve(rande.second - rande.first + 1);
 
-    for (int i = d->visibleIndexRande.first; i < rande.first; ++i) {
+    for (int i = rande.first; i <= rande.second; ++i) {
         const DAbstractFileInfoPointer &fileInfo = model()->fileInfo(model()->index(i, 0));
 
-        if (fileInfo) {
-            fileInfo->makeToInactive();
+        if (!fileInfo)
+            continue;
 
-            if (fileWatcher)
-                fileWatcher->setEnabledSubfileWatcher(fileInfo->fileUrl(), false);
-        }
+        const DUrl &fileUrl = fileInfo->fileUrl();
+
+        visibleUrls << fileUrl;
+
+        if (!d->activeUrls.contains(fileUrl))
+            newVisibleInfos << fileInfo;
     }
 
-    for (int i = rande.second; i < d->visibleIndexRande.second; ++i) {
-        const DAbstractFileInfoPointer &fileInfo = model()->fileInfo(model()->index(i, 0));
+    // 只处理可见状态发生变化的文件
+    for (const DUrl &fileUrl : d->activeUrls) {
+        if (visibleUrls.contains(fileUrl))
+            continue;
 
-        if (fileInfo) {
+        const DAbstractFileInfoPointer &fileInfo = model()->fileInfo(fileUrl);
+
+        if (fileInfo)
             fileInfo->makeToInactive();
-            if (fileWatcher)
-                fileWatcher->setEnabledSubfileWatcher(fileInfo->fileUrl(), false);
-        }
+
+        if (fileWatcher)
+            fileWatcher->setEnabledSubfileWatcher(fileUrl, false);
     }
 
-    d->visibleIndexRande = rande;
+    d->activeUrls = visibleUrls;
 
-    for (int i = rande.first; i <= rande.second; ++i) {
-        const DAbstractFileInfoPointer &fileInfo = model()->fileInfo(model()->index(i, 0));
+    DUrlList localFileUrls;
 
-        if (fileInfo) {
-            fileInfo->makeToActive();
+    for (const DAbstractFileInfoPointer &fileInfo : newVisibleInfos) {
+        const DUrl &fileUrl = fileInfo->fileUrl();
 
-            if (!fileInfo->exists()) {
-                model()->removeRow(i, rootIndex());
-            } else if (fileWatcher) {
-                fileWatcher->setEnabledSubfileWatcher(fileInfo->fileUrl());
-            }
+        fileInfo->makeToActive();
+
+        // 本地文件在线程中检查是否存在，避免在网络文件系统中滚动时卡顿
+        if (fileUrl.isLocalFile()) {
+            localFileUrls << fileUrl;
+        } else if (!fileInfo->exists()) {
+            d->activeUrls.remove(fileUrl);
+            model()->removeRow(model()->index(fileUrl).row(), rootIndex());
+
+            continue;
         }
+
+        if (fileWatcher)
+            fileWatcher->setEnabledSubfileWatcher(fileUrl);
     }
+
+    if (localFileUrls.isEmpty())
+        return;
+
+    QFutureWatcher<DUrlList> *existsWatcher = new QFutureWatcher<DUrlList>(this);
+
+    connect(existsWatcher, &QFutureWatcher<DUrlList>::finished, this, [this, existsWatcher] {
+        Q_D(DFileView);
+
+        existsWatcher->deleteLater();
+
+        for (const DUrl &fileUrl : existsWatcher->result()) {
+            const QModelIndex &index = model()->index(fileUrl);
+
+            // 已经不在当前目录中
+            if (!index.isValid())
+                continue;
+
+            if (d->activeUrls.remove(fileUrl) && model()->fileWatcher())
+                model()->fileWatcher()->setEnabledSubfileWatcher(fileUrl, false);
+
+            model()->removeRow(index.row(), rootIndex());
+        }
+    });
+
+    existsWatcher->setFuture(QtConcurrent::run([localFileUrls] {
+        DUrlList notExistsUrls;
+
+        for (const DUrl &fileUrl : localFileUrls) {
+            const QFileInfo info(fileUrl.toLocalFile());
+
+            if (!info.exists() && !info.isSymLink())
+                notExistsUrls << fileUrl;
+        }
+
+        return notExistsUrls;
+    }));
 }
 
 void DFileView::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
@@ -1700,6 +1767,24 @@ QModelIndex DFileView::moveCursor(QAbstractItemView::CursorAction cursorAction,
 
 void DFileView::rowsAboutToBeRemoved(const QModelIndex &parent, int start, int end)
 {
+    Q_D(DFileView);
+
+    if (parent == rootIndex()) {
+        DAbstractFileWatcher *fileWatcher = model()->fileWatcher();
+
+        for (int i = start; i <= end; ++i) {
+            const DAbstractFileInfoPointer &fileInfo = model()->fileInfo(model()->index(i, 0, parent));
+
+            if (!fileInfo || !d->activeUrls.remove(fileInfo->fileUrl()))
+                continue;
+
+            fileInfo->makeToInactive();
+
+            if (fileWatcher)
+                fileWatcher->setEnabledSubfileWatcher(fileInfo->fileUrl(), false);
+        }
+    }
+
     QModelIndex currentIdx = currentIndex();
     for (const QModelIndex &index : selectedIndexes()) {
         if (index.parent() != parent)
@@ -1713,21 +1798,6 @@ void DFileView::rowsAboutToBeRemoved(const QModelIndex &parent, int start, int e
         }
     }
 
-    Q_D(DFileView);
-
-    if (start < d->visibleIndexRande.second) {
-        if (end <= d->visibleIndexRande.first) {
-            d->visibleIndexRande.first -= (end - start + 1);
-            d->visibleIndexRande.second -= (end - start + 1);
-        } else if (end <= d->visibleIndexRande.second) {
-            d->visibleIndexRande.first = start;
-            d->visibleIndexRande.second -= (end - start + 1);
-        } else {
-            d->visibleIndexRande.first = d->visibleIndexRande.second = -1;
-        }
-
-    }
-
     DListView::rowsAboutToBeRemoved(parent, start, end);
 }
 
@@ -1938,9 +2008,19 @@ void DFileView::initConnects()
     connect(model(), &DFileSystemModel::dataChanged, this, &DFileView::handleDataChanged);
     connect(model(), &DFileSystemModel::stateChanged, this, &DFileView::onModelStateChanged);
     connect(model(), &DFileSystemModel::rootUrlDeleted, this, &DFileView::onRootUrlDeleted);
+    // 切换目录或重置模型后原来的文件都已不在视图中，其监视器也已随之销毁
+    connect(model(), &DFileSystemModel::modelReset, this, [this] {
+        Q_D(DFileView);
+
+        d->activeUrls.clear();
+    });
+    connect(this, &DFileView::rootUrlChanged, this, [this] {
+        Q_D(DFileView);
+
+        d->activeUrls.clear();
+    });
 
     connect(this, &DFileView::iconSizeChanged, this, &DFileView::updateHorizontalOffset, Qt::QueuedConnection);
-    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &DFileView::updateModelActiveIndex);
 
     connect(DFMApplication::instance(), &DFMApplication::iconSizeLevelChanged, this, &DFileView::setIconSizeBySizeIndex);
     connect(DFMApplication::instance(), &DFMApplication::showedHiddenFilesChanged, this, &DFileView::onShowHiddenFileChanged);
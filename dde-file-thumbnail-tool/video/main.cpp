@@ -23,85 +23,60 @@
 #include <iostream>
 #include <sstream>
 #include <cstring>
+#include <cstdio>
 
-enum Base64Option {
-    Base64Encoding = 0,
-    Base64UrlEncoding = 1,
-
-    KeepTrailingEquals = 0,
-    OmitTrailingEquals = 2
-};
-
-char *toBase64(const unsigned char *data, int size, int options)
+// 常驻模式，从标准输入循环读取请求，协议参见dde-file-manager-lib中的ThumbnailToolProcess
+int runPersistent()
 {
-    const char alphabet_base64[] = "ABCDEFGH" "IJKLMNOP" "QRSTUVWX" "YZabcdef"
-                                   "ghijklmn" "opqrstuv" "wxyz0123" "456789+/";
-    const char alphabet_base64url[] = "ABCDEFGH" "IJKLMNOP" "QRSTUVWX" "YZabcdef"
-                                      "ghijklmn" "opqrstuv" "wxyz0123" "456789-_";
-    const char *const alphabet = options & Base64UrlEncoding ? alphabet_base64url : alphabet_base64;
-    const char padchar = '=';
-    int padlen = 0;
-
-    int tmp_size = (size + 2) / 3 * 4;
-    char *tmp = new char[tmp_size + 1];
-    tmp[tmp_size] = '\0';
-
-    int i = 0;
-    char *out = tmp;
-    while (i < size) {
-        // encode 3 bytes at a time
-        int chunk = 0;
-        chunk |= int((data[i++])) << 16;
-        if (i == size) {
-            padlen = 2;
-        } else {
-            chunk |= int((data[i++])) << 8;
-            if (i == size)
-                padlen = 1;
-            else
-                chunk |= int((data[i++]));
+    ffmpegthumbnailer::VideoThumbnailer vt(0, false, true, 20, false);
+    int32_t header[2];
+
+    while (fread(header, sizeof(header), 1, stdin) == 1) {
+        if (header[1] < 0) {
+            return -1;
         }
 
-        int j = (chunk & 0x00fc0000) >> 18;
-        int k = (chunk & 0x0003f000) >> 12;
-        int l = (chunk & 0x00000fc0) >> 6;
-        int m = (chunk & 0x0000003f);
-        *out++ = alphabet[j];
-        *out++ = alphabet[k];
-
-        if (padlen > 1) {
-            if ((options & OmitTrailingEquals) == 0)
-                *out++ = padchar;
-        } else {
-            *out++ = alphabet[l];
+        std::string path(header[1], '\0');
+
+        if (header[1] > 0 && fread(&path[0], header[1], 1, stdin) != 1) {
+            return -1;
         }
-        if (padlen > 0) {
-            if ((options & OmitTrailingEquals) == 0)
-                *out++ = padchar;
-        } else {
-            *out++ = alphabet[m];
+
+        std::vector<uint8_t> imageData;
+        int32_t status = 0;
+
+        try {
+            vt.setThumbnailSize(header[0]);
+            vt.generateThumbnail(path, ThumbnailerImageTypeEnum::Png, imageData);
+        } catch (std::exception &e) {
+            const char *error = e.what();
+
+            status = -1;
+            imageData.assign(error, error + strlen(error));
         }
-    }
 
-    if (!((options & OmitTrailingEquals) || (out == tmp_size + tmp))) {
-        std::abort();
-    }
+        const int32_t reply[2] = {status, int32_t(imageData.size())};
 
-    if (options & OmitTrailingEquals) {
-        int new_size = out - tmp;
-        char *new_tmp = new char[new_size + 1];
+        if (fwrite(reply, sizeof(reply), 1, stdout) != 1) {
+            return -1;
+        }
 
-        memcpy(new_tmp, tmp, new_size);
-        delete[] tmp;
+        if (!imageData.empty() && fwrite(imageData.data(), imageData.size(), 1, stdout) != 1) {
+            return -1;
+        }
 
-        tmp = new_tmp;
+        fflush(stdout);
     }
 
-    return tmp;
+    return 0;
 }
 
 int main(int argc, char *argv[])
 {
+    if (argc == 2 && strcmp(argv[1], "--persistent") == 0) {
+        return runPersistent();
+    }
+
     if (argc != 3) {
         return -1;
     }
@@ -118,9 +93,7 @@ int main(int argc, char *argv[])
         ffmpegthumbnailer::VideoThumbnailer vt(size, false, true, 20, false);
         vt.generateThumbnail(path, ThumbnailerImageTypeEnum::Png, imageData);
 
-        char *base64_data = toBase64(imageData.data(), imageData.size(), Base64Encoding);
-
-        printf("%s", base64_data);
+        fwrite(imageData.data(), imageData.size(), 1, stdout);
         fflush(stdout);
     } catch (std::logic_error e) {
         std::cerr << e.what();
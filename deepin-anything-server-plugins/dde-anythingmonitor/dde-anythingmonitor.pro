@@ -71,6 +71,7 @@ SOURCES += \
     $$DDE_FILE_MANAGER_LIB_DIR/interfaces/dfmapplication.cpp \
     $$DDE_FILE_MANAGER_LIB_DIR/interfaces/dfmsettings.cpp \
     taghandle.cpp \
+    taggedpathfilter.cpp \
     main.cpp
 
 
@@ -84,7 +85,8 @@ HEADERS += \
     $$DDE_FILE_MANAGER_LIB_DIR/interfaces/dfmstandardpaths.h \
     $$DDE_FILE_MANAGER_LIB_DIR/interfaces/dfmapplication.h \
     $$DDE_FILE_MANAGER_LIB_DIR/interfaces/dfmsettings.h \
-    taghandle.h
+    taghandle.h \
+    taggedpathfilter.h
 
 
 
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2017 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "taggedpathfilter.h"
+
+#include <QHash>
+
+
+///###: about 1% false positive rate with 10 bits and 7 hashes for each path.
+static constexpr const int BITS_PER_PATH{ 10 };
+static constexpr const int HASH_COUNT{ 7 };
+static constexpr const uint SECOND_HASH_SEED{ 0x9e3779b9 };
+
+void TaggedPathFilter::reset(int capacity)
+{
+    m_capacity = capacity;
+    m_count = 0;
+    m_bits = QBitArray{ capacity * BITS_PER_PATH };
+}
+
+void TaggedPathFilter::insert(const QByteArray &path)
+{
+    if (m_bits.isEmpty()) {
+        return;
+    }
+
+    const uint size{ static_cast<uint>(m_bits.size()) };
+    const uint first_hash{ qHash(path) };
+    const uint second_hash{ qHash(path, SECOND_HASH_SEED) | 1u };
+
+    for (int i = 0; i < HASH_COUNT; ++i) {
+        m_bits.setBit(static_cast<int>((first_hash + i * second_hash) % size));
+    }
+
+    ++m_count;
+}
+
+bool TaggedPathFilter::contains(const QByteArray &path) const
+{
+    if (m_bits.isEmpty()) {
+        return false;
+    }
+
+    const uint size{ static_cast<uint>(m_bits.size()) };
+    const uint first_hash{ qHash(path) };
+    const uint second_hash{ qHash(path, SECOND_HASH_SEED) | 1u };
+
+    for (int i = 0; i < HASH_COUNT; ++i) {
+
+        if (!m_bits.testBit(static_cast<int>((first_hash + i * second_hash) % size))) {
+            return false;
+        }
+    }
+
+    return true;
+}
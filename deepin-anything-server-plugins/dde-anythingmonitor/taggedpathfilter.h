@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2017 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TAGGEDPATHFILTER_H
+#define TAGGEDPATHFILTER_H
+
+#include <QBitArray>
+#include <QByteArray>
+
+
+///###: a bloom filter of the tagged files.
+///###: if contains() returns false, the file was not tagged certainly.
+class TaggedPathFilter
+{
+public:
+    TaggedPathFilter() = default;
+
+    void reset(int capacity);
+    void insert(const QByteArray &path);
+    bool contains(const QByteArray &path) const;
+
+    inline bool isEmpty() const noexcept
+    {
+        return m_bits.isEmpty();
+    }
+
+    ///###: the false positive rate grows quickly when there are more paths than the capacity.
+    inline bool isFull() const noexcept
+    {
+        return m_count > m_capacity;
+    }
+
+private:
+    QBitArray m_bits{};
+    int m_capacity{ 0 };
+    int m_count{ 0 };
+};
+
+#endif // TAGGEDPATHFILTER_H
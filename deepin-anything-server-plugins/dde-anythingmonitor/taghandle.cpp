@@ -23,9 +23,41 @@
 #include "taghandle.h"
 
 #include <tag/tagmanager.h>
+#include <tag/tagutil.h>
 #include <shutil/danythingmonitorfilter.h>
+#include <controllers/tagmanagerdaemoncontroller.h>
 
+#include <QSet>
+#include <QHash>
 
+#include <functional>
+
+
+///###: the changes are synchronized with sqlite after this interval, or when there are too many.
+static constexpr const int FLUSH_INTERVAL{ 1000 };
+static constexpr const int MAX_CHANGED_FILES{ 1000 };
+static constexpr const int MIN_FILTER_CAPACITY{ 4096 };
+
+TagHandle::TagHandle(QObject *const parent)
+    : DASInterface{ parent }
+    , m_flushTimer{ new QTimer{ this } }
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(FLUSH_INTERVAL);
+
+    QObject::connect(m_flushTimer, &QTimer::timeout, this, &TagHandle::flushChangedFiles);
+    QObject::connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::filesWereTagged, this, [this](const QVariantMap & files_were_tagged) {
+
+        if (m_taggedPaths.isEmpty()) {
+            return;
+        }
+
+        ///###: the keys are the escaped names stored in sqlite.
+        for (const QString &file : files_were_tagged.keys()) {
+            m_taggedPaths.insert(Tag::restore_escaped_en_skim(file).toLocal8Bit());
+        }
+    });
+}
 
 void TagHandle::onFileCreate(const QByteArrayList &files)
 {
@@ -37,19 +69,18 @@ void TagHandle::onFileCreate(const QByteArrayList &files)
 void TagHandle::onFileDelete(const QByteArrayList &files)
 {
     if (!files.isEmpty()) {
-        QList<DUrl> url_list{};
+        QList<QPair<QByteArray, QByteArray>> changed_files{};
 
         for (const QByteArray &byte_array : files) {
             bool result{ DAnythingMonitorFilter::instance()->whetherFilterCurrentPath(byte_array) };
 
             if (result) {
-                DUrl url{ DUrl::fromLocalFile(byte_array) };
-                url_list.push_back(url);
+                changed_files.push_back({ byte_array, QByteArray{} });
             }
 
         }
 
-        TagManager::deleteFiles(url_list);
+        this->appendChangedFiles(changed_files);
     }
 }
 
@@ -57,13 +88,142 @@ void TagHandle::onFileDelete(const QByteArrayList &files)
 void TagHandle::onFileRename(const QList<QPair<QByteArray, QByteArray>> &files)
 {
     if (!files.isEmpty()) {
+        QList<QPair<QByteArray, QByteArray>> changed_files{};
 
         for (const QPair<QByteArray, QByteArray> &names : files) {
             bool result{ DAnythingMonitorFilter::instance()->whetherFilterCurrentPath(names.second) };
 
             if (result) {
-                TagManager::changeFilesName({ names });
+                changed_files.push_back(names);
             }
         }
+
+        this->appendChangedFiles(changed_files);
+    }
+}
+
+void TagHandle::appendChangedFiles(const QList<QPair<QByteArray, QByteArray>> &files)
+{
+    if (files.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker{ &m_mutex };
+    bool was_empty{ m_changedFiles.isEmpty() };
+
+    m_changedFiles += files;
+
+    ///###: the handler may be called in other threads, so the timer is started by the event loop.
+    if (m_changedFiles.size() >= MAX_CHANGED_FILES) {
+        QMetaObject::invokeMethod(this, "flushChangedFiles", Qt::QueuedConnection);
+    } else if (was_empty) {
+        QMetaObject::invokeMethod(m_flushTimer, "start", Qt::QueuedConnection);
+    }
+}
+
+void TagHandle::flushChangedFiles()
+{
+    QList<QPair<QByteArray, QByteArray>> changed_files{};
+
+    m_mutex.lock();
+    changed_files.swap(m_changedFiles);
+    m_mutex.unlock();
+
+    if (changed_files.isEmpty()) {
+        return;
+    }
+
+    if (m_taggedPaths.isEmpty() || m_taggedPaths.isFull()) {
+        this->loadTaggedPaths();
+    }
+
+    QList<DUrl> deleted_files{};
+    QList<QPair<QByteArray, QByteArray>> renamed_files{};
+    ///###: <new name, index in renamed_files>
+    QHash<QByteArray, int> new_names{};
+    QSet<QByteArray> old_names{};
+
+    std::function<void()> flushRenamedFiles{ [&] {
+
+            if (!renamed_files.isEmpty()) {
+                TagManager::changeFilesName(renamed_files);
+                renamed_files.clear();
+                new_names.clear();
+                old_names.clear();
+            }
+        } };
+
+    for (const QPair<QByteArray, QByteArray> &names : changed_files) {
+
+        ///###: the file was not tagged, there is nothing to do.
+        if (!m_taggedPaths.isEmpty() && !m_taggedPaths.contains(names.first)) {
+            continue;
+        }
+
+        if (names.second.isEmpty()) {
+            flushRenamedFiles();
+            deleted_files.push_back(DUrl::fromLocalFile(QString::fromLocal8Bit(names.first)));
+
+            continue;
+        }
+
+        if (!deleted_files.isEmpty()) {
+            TagManager::deleteFiles(deleted_files);
+            deleted_files.clear();
+        }
+
+        m_taggedPaths.insert(names.second);
+
+        ///###: A -> B, B -> C is the same as A -> C.
+        if (new_names.contains(names.first)) {
+            int index{ new_names.take(names.first) };
+
+            renamed_files[index].second = names.second;
+            new_names[names.second] = index;
+
+            continue;
+        }
+
+        ///###: the files are renamed in one map of <old name, new name>, so the old names must be different.
+        if (old_names.contains(names.first)) {
+            flushRenamedFiles();
+        }
+
+        old_names.insert(names.first);
+        new_names[names.second] = renamed_files.size();
+        renamed_files.push_back(names);
+    }
+
+    flushRenamedFiles();
+
+    if (!deleted_files.isEmpty()) {
+        TagManager::deleteFiles(deleted_files);
+    }
+}
+
+void TagHandle::loadTaggedPaths()
+{
+    QMap<QString, QVariant> placeholder_container{ { QString{" "}, QVariant{ QList<QString>{ QString{" "} } } } };
+    QVariant var{ TagManagerDaemonController::instance()->disposeClientData(placeholder_container, Tag::ActionType::GetAllTags) };
+    const QList<QString> &tags{ var.toMap().keys() };
+    QList<QString> files{};
+
+    for (const QString &tag : tags) {
+        QMap<QString, QVariant> string_var{ { tag, QVariant{ QList<QString>{ QString{" "} } } } };
+        var = TagManagerDaemonController::instance()->disposeClientData(string_var, Tag::ActionType::GetFilesThroughTag);
+        files += var.toStringList();
+    }
+
+    ///###: an empty filter lets every file pass, when the daemon is not available.
+    if (tags.isEmpty() && !var.isValid()) {
+        m_taggedPaths.reset(0);
+
+        return;
+    }
+
+    m_taggedPaths.reset(qMax(MIN_FILTER_CAPACITY, files.size() * 2));
+
+    for (const QString &file : files) {
+        m_taggedPaths.insert(file.toLocal8Bit());
     }
 }
@@ -23,6 +23,11 @@
 
 #include <dasinterface.h>
 
+#include "taggedpathfilter.h"
+
+#include <QMutex>
+#include <QTimer>
+
 
 using namespace DAS_NAMESPACE;
 
@@ -31,8 +36,7 @@ class TagHandle : public DASInterface
     Q_OBJECT
 
 public:
-    explicit TagHandle(QObject *const parent = nullptr)
-        : DASInterface{ parent } {}
+    explicit TagHandle(QObject *const parent = nullptr);
     virtual ~TagHandle() = default;
 
     TagHandle(const TagHandle &other) = delete;
@@ -42,6 +46,21 @@ public:
     virtual void onFileCreate(const QByteArrayList &files) override;
     virtual void onFileDelete(const QByteArrayList &files) override;
     virtual void onFileRename(const QList<QPair<QByteArray, QByteArray>> &files) override;
+
+private slots:
+    void flushChangedFiles();
+
+private:
+    void appendChangedFiles(const QList<QPair<QByteArray, QByteArray>> &files);
+    void loadTaggedPaths();
+
+    ///###: <old name, new name>, the new name of a deleted file is empty.
+    ///###: deleting and renaming use the same list, so they are synchronized with sqlite in order.
+    QList<QPair<QByteArray, QByteArray>> m_changedFiles{};
+    QMutex m_mutex{};
+    QTimer *m_flushTimer{ nullptr };
+
+    TaggedPathFilter m_taggedPaths{};
 };
 
 #endif // TAGHANDLE_H
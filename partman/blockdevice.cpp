@@ -0,0 +1,736 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *               2016 ~ 2018 dragondjf
+ *
+ * Author:     dragondjf<dingjiangfeng@deepin.com>
+ *
+ * Maintainer: dragondjf<dingjiangfeng@deepin.com>
+ *             zccrs<zhangjide@deepin.com>
+ *             Tangtong<tangtong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "blockdevice.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QtAlgorithms>
+#include <QtEndian>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+namespace PartMan {
+
+namespace {
+
+// Bitmaps and allocation tables are read in chunks of this size.
+const qint64 kReadChunkSize = 1024 * 1024;
+
+class DeviceFile {
+ public:
+  explicit DeviceFile(const QString& path)
+      : fd_(::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC)) {
+  }
+
+  ~DeviceFile() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  // Read |size| bytes at |offset| into |data|.
+  bool read(qint64 offset, int size, QByteArray& data) const {
+    if (fd_ < 0 || offset < 0 || size < 0) {
+      return false;
+    }
+
+    data.resize(size);
+    int done = 0;
+    while (done < size) {
+      const ssize_t ret = ::pread(fd_, data.data() + done, size - done,
+                                  offset + done);
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ret <= 0) {
+        return false;
+      }
+      done += ret;
+    }
+
+    return true;
+  }
+
+  // Count set bits in the first |bits| bits stored at |offset|.
+  bool countSetBits(qint64 offset, qint64 bits, qint64& count) const {
+    const qint64 bytes = (bits + 7) / 8;
+    QByteArray data;
+
+    count = 0;
+    for (qint64 done = 0; done < bytes; done += kReadChunkSize) {
+      const int size = static_cast<int>(qMin(kReadChunkSize, bytes - done));
+      if (!read(offset + done, size, data)) {
+        return false;
+      }
+
+      for (int i = 0; i < size; ++i) {
+        quint8 byte = static_cast<quint8>(data.at(i));
+        const qint64 remaining_bits = bits - (done + i) * 8;
+        if (remaining_bits < 8) {
+          byte &= (1 << remaining_bits) - 1;
+        }
+        count += qPopulationCount(byte);
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  int fd_;
+};
+
+template <typename T>
+T LittleEndian(const QByteArray& data, int offset) {
+  return qFromLittleEndian<T>(
+      reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+template <typename T>
+T BigEndian(const QByteArray& data, int offset) {
+  return qFromBigEndian<T>(
+      reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+quint8 Byte(const QByteArray& data, int offset) {
+  return static_cast<quint8>(data.at(offset));
+}
+
+// Decode octal escapes, such as "\040", used in /proc/self/mountinfo.
+QByteArray UnescapeMountInfo(const QByteArray& value) {
+  QByteArray result;
+  result.reserve(value.size());
+
+  for (int i = 0; i < value.size(); ++i) {
+    if (value.at(i) == '\\' && i + 3 < value.size() &&
+        value.at(i + 1) >= '0' && value.at(i + 1) <= '3') {
+      bool ok = false;
+      const char ch = static_cast<char>(value.mid(i + 1, 3).toInt(&ok, 8));
+      if (ok) {
+        result.append(ch);
+        i += 3;
+        continue;
+      }
+    }
+    result.append(value.at(i));
+  }
+
+  return result;
+}
+
+// Decode hex escapes, such as "\x20", used in udev database.
+QString UnescapeUdevValue(const QByteArray& value) {
+  QByteArray result;
+  result.reserve(value.size());
+
+  for (int i = 0; i < value.size(); ++i) {
+    if (value.at(i) == '\\' && i + 3 < value.size() &&
+        value.at(i + 1) == 'x') {
+      bool ok = false;
+      const char ch = static_cast<char>(value.mid(i + 2, 2).toInt(&ok, 16));
+      if (ok) {
+        result.append(ch);
+        i += 3;
+        continue;
+      }
+    }
+    result.append(value.at(i));
+  }
+
+  return QString::fromUtf8(result);
+}
+
+QByteArray ReadSysfsValue(const QString& path) {
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly)) {
+    return QByteArray();
+  }
+  return file.readAll().trimmed();
+}
+
+bool IsExtSuperBlock(const QByteArray& sb) {
+  return LittleEndian<quint16>(sb, 0x38) == 0xEF53;
+}
+
+bool IsXfsSuperBlock(const QByteArray& sb) {
+  return BigEndian<quint32>(sb, 0) == 0x58465342;  // "XFSB"
+}
+
+bool IsBtrfsSuperBlock(const QByteArray& sb) {
+  return memcmp(sb.constData() + 0x40, "_BHRfS_M", 8) == 0;
+}
+
+bool IsNtfsBootSector(const QByteArray& bs) {
+  return memcmp(bs.constData() + 3, "NTFS    ", 8) == 0;
+}
+
+bool IsExfatBootSector(const QByteArray& bs) {
+  return memcmp(bs.constData() + 3, "EXFAT   ", 8) == 0;
+}
+
+bool IsFatBootSector(const QByteArray& bs) {
+  const quint16 bytes_per_sector = LittleEndian<quint16>(bs, 11);
+  const quint8 sectors_per_cluster = Byte(bs, 13);
+  return (Byte(bs, 0) == 0xEB || Byte(bs, 0) == 0xE9) &&
+         (bytes_per_sector == 512 || bytes_per_sector == 1024 ||
+          bytes_per_sector == 2048 || bytes_per_sector == 4096) &&
+         sectors_per_cluster > 0 &&
+         (sectors_per_cluster & (sectors_per_cluster - 1)) == 0 &&
+         Byte(bs, 16) > 0 && LittleEndian<quint16>(bs, 14) > 0;
+}
+
+}  // namespace
+
+bool ReadBlockDeviceInfo(const QString& devicePath, BlockDeviceInfo& info) {
+  struct stat device_stat;
+  if (::stat(QFile::encodeName(devicePath).constData(), &device_stat) != 0 ||
+      !S_ISBLK(device_stat.st_mode)) {
+    return false;
+  }
+
+  const QString device_id = QString("%1:%2").arg(major(device_stat.st_rdev))
+                                            .arg(minor(device_stat.st_rdev));
+  const QString sys_path =
+      QFileInfo("/sys/dev/block/" + device_id).canonicalFilePath();
+  if (sys_path.isEmpty()) {
+    return false;
+  }
+
+  // udev rewrites its database file whenever the device changes, e.g. after
+  // formatting, so its modification time is used as device generation.
+  const QString udev_data_path = "/run/udev/data/b" + device_id;
+  struct stat udev_data_stat;
+  qint64 generation = -1;
+  if (::stat(QFile::encodeName(udev_data_path).constData(),
+             &udev_data_stat) == 0) {
+    generation = static_cast<qint64>(udev_data_stat.st_mtim.tv_sec) *
+                     1000000000 + udev_data_stat.st_mtim.tv_nsec;
+  }
+
+  static QMutex cache_lock;
+  static QHash<quint64, QPair<qint64, BlockDeviceInfo>> cache;
+
+  if (generation >= 0) {
+    QMutexLocker locker(&cache_lock);
+    const auto cached = cache.constFind(device_stat.st_rdev);
+    if (cached != cache.constEnd() && cached->first == generation) {
+      info = cached->second;
+      return true;
+    }
+  }
+
+  info = BlockDeviceInfo();
+  info.name = QFileInfo(sys_path).fileName();
+
+  // Partitions inherit removable attribute of their disk.
+  if (QFile::exists(sys_path + "/partition")) {
+    info.removable = ReadSysfsValue(sys_path + "/../removable") == "1";
+  } else {
+    info.removable = ReadSysfsValue(sys_path + "/removable") == "1";
+  }
+
+  QFile udev_data(udev_data_path);
+  if (udev_data.open(QFile::ReadOnly)) {
+    QString label;
+    for (const QByteArray& line : udev_data.readAll().split('\n')) {
+      if (line.startsWith("E:ID_FS_TYPE=")) {
+        info.fs = QString::fromUtf8(line.mid(13));
+      } else if (line.startsWith("E:ID_FS_LABEL_ENC=")) {
+        info.label = UnescapeUdevValue(line.mid(18));
+      } else if (line.startsWith("E:ID_FS_LABEL=")) {
+        label = QString::fromUtf8(line.mid(14));
+      } else if (line.startsWith("E:ID_FS_UUID=")) {
+        info.uuid = QString::fromUtf8(line.mid(13));
+      }
+    }
+    if (info.label.isEmpty()) {
+      info.label = label;
+    }
+  }
+
+  if (info.fs.isEmpty()) {
+    info.fs = ProbeFileSystem(devicePath);
+  }
+
+  if (generation >= 0) {
+    QMutexLocker locker(&cache_lock);
+    cache.insert(device_stat.st_rdev, qMakePair(generation, info));
+  }
+
+  return true;
+}
+
+QString GetDeviceMountPoint(const QString& devicePath) {
+  struct stat device_stat;
+  QByteArray device_id;
+  if (::stat(QFile::encodeName(devicePath).constData(), &device_stat) == 0 &&
+      S_ISBLK(device_stat.st_mode)) {
+    device_id = QByteArray::number(major(device_stat.st_rdev)) + ':' +
+                QByteArray::number(minor(device_stat.st_rdev));
+  }
+
+  QString device = QFileInfo(devicePath).canonicalFilePath();
+  if (device.isEmpty()) {
+    device = devicePath;
+  }
+
+  QFile mount_info("/proc/self/mountinfo");
+  if (!mount_info.open(QFile::ReadOnly)) {
+    return QString();
+  }
+
+  // Format of each line:
+  // id parent major:minor root mount-point options [optional...] - type source super-options
+  for (const QByteArray& line : mount_info.readAll().split('\n')) {
+    const QList<QByteArray> fields = line.split(' ');
+    const int separator = fields.indexOf("-");
+    if (separator < 6 || fields.size() < separator + 3) {
+      continue;
+    }
+
+    bool matched = !device_id.isEmpty() && fields.at(2) == device_id;
+
+    // Some file systems, e.g. btrfs, report anonymous device numbers.
+    if (!matched) {
+      const QString source =
+          QFile::decodeName(UnescapeMountInfo(fields.at(separator + 2)));
+      matched = source.startsWith("/dev/") &&
+                (source == device ||
+                 QFileInfo(source).canonicalFilePath() == device);
+    }
+
+    if (matched) {
+      return QFile::decodeName(UnescapeMountInfo(fields.at(4)));
+    }
+  }
+
+  return QString();
+}
+
+QString ProbeFileSystem(const QString& devicePath) {
+  const DeviceFile file(devicePath);
+  QByteArray data;
+
+  if (file.read(1024, 1024, data) && IsExtSuperBlock(data)) {
+    const quint32 compat = LittleEndian<quint32>(data, 0x5C);
+    const quint32 incompat = LittleEndian<quint32>(data, 0x60);
+    // extents, 64bit, flex_bg
+    if (incompat & (0x40 | 0x80 | 0x200)) {
+      return "ext4";
+    }
+    // has_journal
+    if (compat & 0x4) {
+      return "ext3";
+    }
+    return "ext2";
+  }
+
+  if (file.read(0x10000, 0x100, data) && IsBtrfsSuperBlock(data)) {
+    return "btrfs";
+  }
+
+  if (!file.read(0, 512, data)) {
+    return QString();
+  }
+
+  if (IsXfsSuperBlock(data)) {
+    return "xfs";
+  }
+  if (IsNtfsBootSector(data)) {
+    return "ntfs";
+  }
+  if (IsExfatBootSector(data)) {
+    return "exfat";
+  }
+  if (IsFatBootSector(data) &&
+      (memcmp(data.constData() + 54, "FAT", 3) == 0 ||
+       memcmp(data.constData() + 82, "FAT32", 5) == 0)) {
+    return "vfat";
+  }
+
+  return QString();
+}
+
+bool ReadMountedUsage(const QString& mountPoint, qlonglong& freespace,
+                      qlonglong& total) {
+  struct statvfs info;
+  if (::statvfs(QFile::encodeName(mountPoint).constData(), &info) != 0) {
+    return false;
+  }
+
+  total = static_cast<qlonglong>(info.f_blocks) * info.f_frsize;
+  freespace = static_cast<qlonglong>(info.f_bavail) * info.f_frsize;
+  return total > 0;
+}
+
+bool ReadExtSuperBlock(const QString& devicePath, qlonglong& freespace,
+                       qlonglong& total) {
+  const DeviceFile file(devicePath);
+  QByteArray sb;
+  if (!file.read(1024, 1024, sb) || !IsExtSuperBlock(sb)) {
+    return false;
+  }
+
+  const quint32 log_block_size = LittleEndian<quint32>(sb, 0x18);
+  if (log_block_size > 6) {
+    return false;
+  }
+
+  const qlonglong block_size = 1024LL << log_block_size;
+  quint64 total_blocks = LittleEndian<quint32>(sb, 0x04);
+  quint64 free_blocks = LittleEndian<quint32>(sb, 0x0C);
+
+  // INCOMPAT_64BIT
+  if (LittleEndian<quint32>(sb, 0x60) & 0x80) {
+    total_blocks |= static_cast<quint64>(LittleEndian<quint32>(sb, 0x150)) << 32;
+    free_blocks |= static_cast<quint64>(LittleEndian<quint32>(sb, 0x158)) << 32;
+  }
+
+  total = total_blocks * block_size;
+  freespace = free_blocks * block_size;
+  return true;
+}
+
+bool ReadBtrfsSuperBlock(const QString& devicePath, qlonglong& freespace,
+                         qlonglong& total) {
+  const DeviceFile file(devicePath);
+  QByteArray sb;
+  if (!file.read(0x10000, 0x100, sb) || !IsBtrfsSuperBlock(sb)) {
+    return false;
+  }
+
+  total = LittleEndian<quint64>(sb, 0x70);
+  freespace = total - static_cast<qlonglong>(LittleEndian<quint64>(sb, 0x78));
+  return (total > 0 && freespace > -1);
+}
+
+bool ReadXfsSuperBlock(const QString& devicePath, qlonglong& freespace,
+                       qlonglong& total) {
+  const DeviceFile file(devicePath);
+  QByteArray sb;
+  if (!file.read(0, 0x100, sb) || !IsXfsSuperBlock(sb)) {
+    return false;
+  }
+
+  const qlonglong block_size = BigEndian<quint32>(sb, 4);
+  total = BigEndian<quint64>(sb, 8) * block_size;
+  freespace = BigEndian<quint64>(sb, 0x90) * block_size;
+  return (total > 0 && freespace > -1);
+}
+
+bool ReadFatSuperBlock(const QString& devicePath, qlonglong& freespace,
+                       qlonglong& total) {
+  const DeviceFile file(devicePath);
+  QByteArray bs;
+  if (!file.read(0, 512, bs) || !IsFatBootSector(bs)) {
+    return false;
+  }
+
+  const qint64 bytes_per_sector = LittleEndian<quint16>(bs, 11);
+  const qint64 sectors_per_cluster = Byte(bs, 13);
+  const qint64 reserved_sectors = LittleEndian<quint16>(bs, 14);
+  const qint64 fat_count = Byte(bs, 16);
+  const qint64 root_entries = LittleEndian<quint16>(bs, 17);
+  const qint64 fat_sectors = LittleEndian<quint16>(bs, 22) ?
+                             LittleEndian<quint16>(bs, 22) :
+                             LittleEndian<quint32>(bs, 36);
+  const qint64 total_sectors = LittleEndian<quint16>(bs, 19) ?
+                               LittleEndian<quint16>(bs, 19) :
+                               LittleEndian<quint32>(bs, 32);
+  const qint64 root_dir_sectors =
+      (root_entries * 32 + bytes_per_sector - 1) / bytes_per_sector;
+  const qint64 data_sectors = total_sectors - reserved_sectors -
+                              fat_count * fat_sectors - root_dir_sectors;
+  if (fat_sectors <= 0 || data_sectors <= 0) {
+    return false;
+  }
+
+  const qint64 cluster_size = bytes_per_sector * sectors_per_cluster;
+  const qint64 cluster_count = data_sectors / sectors_per_cluster;
+  const qint64 fat_offset = reserved_sectors * bytes_per_sector;
+  const qint64 fat_size = fat_sectors * bytes_per_sector;
+  total = cluster_count * cluster_size;
+
+  if (cluster_count >= 65525) {
+    // FAT32 keeps free cluster count in its FSInfo sector.
+    QByteArray fs_info;
+    const qint64 fs_info_sector = LittleEndian<quint16>(bs, 48);
+    if (fs_info_sector > 0 &&
+        file.read(fs_info_sector * bytes_per_sector, 512, fs_info) &&
+        LittleEndian<quint32>(fs_info, 0) == 0x41615252 &&
+        LittleEndian<quint32>(fs_info, 484) == 0x61417272) {
+      const quint32 free_clusters = LittleEndian<quint32>(fs_info, 488);
+      if (free_clusters <= cluster_count) {
+        freespace = free_clusters * cluster_size;
+        return true;
+      }
+    }
+  }
+
+  // Count free entries in the first allocation table, entry 0 and 1 are
+  // reserved.
+  const qint64 entry_count = cluster_count + 2;
+  qint64 free_clusters = 0;
+  QByteArray fat;
+
+  if (cluster_count < 4085) {
+    // FAT12 packs two entries into three bytes.
+    const int size = static_cast<int>(qMin(entry_count * 3 / 2 + 2, fat_size));
+    if (!file.read(fat_offset, size, fat)) {
+      return false;
+    }
+    for (qint64 i = 2; i < entry_count && i + i / 2 + 2 <= size; ++i) {
+      quint16 value = LittleEndian<quint16>(fat, static_cast<int>(i + i / 2));
+      value = (i & 1) ? (value >> 4) : (value & 0xFFF);
+      if (value == 0) {
+        ++free_clusters;
+      }
+    }
+  } else {
+    const qint64 entry_size = cluster_count < 65525 ? 2 : 4;
+    const qint64 chunk_entries = kReadChunkSize / entry_size;
+    const qint64 table_entries = qMin(entry_count, fat_size / entry_size);
+    for (qint64 first = 0; first < table_entries; first += chunk_entries) {
+      const qint64 count = qMin(chunk_entries, table_entries - first);
+      if (!file.read(fat_offset + first * entry_size,
+                     static_cast<int>(count * entry_size), fat)) {
+        return false;
+      }
+      for (qint64 i = qMax<qint64>(0, 2 - first); i < count; ++i) {
+        const quint32 value = entry_size == 2 ?
+            LittleEndian<quint16>(fat, static_cast<int>(i * 2)) :
+            LittleEndian<quint32>(fat, static_cast<int>(i * 4)) & 0x0FFFFFFF;
+        if (value == 0) {
+          ++free_clusters;
+        }
+      }
+    }
+  }
+
+  freespace = free_clusters * cluster_size;
+  return true;
+}
+
+bool ReadExfatSuperBlock(const QString& devicePath, qlonglong& freespace,
+                         qlonglong& total) {
+  const DeviceFile file(devicePath);
+  QByteArray bs;
+  if (!file.read(0, 512, bs) || !IsExfatBootSector(bs)) {
+    return false;
+  }
+
+  const int bytes_per_sector_shift = Byte(bs, 108);
+  const int sectors_per_cluster_shift = Byte(bs, 109);
+  if (bytes_per_sector_shift < 9 || bytes_per_sector_shift > 12 ||
+      bytes_per_sector_shift + sectors_per_cluster_shift > 25) {
+    return false;
+  }
+
+  const qint64 bytes_per_sector = 1LL << bytes_per_sector_shift;
+  const qint64 cluster_size =
+      1LL << (bytes_per_sector_shift + sectors_per_cluster_shift);
+  const qint64 cluster_heap_offset =
+      LittleEndian<quint32>(bs, 88) * bytes_per_sector;
+  const qint64 cluster_count = LittleEndian<quint32>(bs, 92);
+  const qint64 root_cluster = LittleEndian<quint32>(bs, 96);
+  const int percent_in_use = Byte(bs, 112);
+  total = cluster_count * cluster_size;
+
+  // Find allocation bitmap in the first cluster of root directory. The
+  // bitmap is created contiguous by mkfs, so it is read without following
+  // its cluster chain.
+  QByteArray root_dir;
+  if (root_cluster >= 2 &&
+      file.read(cluster_heap_offset + (root_cluster - 2) * cluster_size,
+                static_cast<int>(qMin<qint64>(cluster_size, 64 * 1024)),
+                root_dir)) {
+    for (int offset = 0; offset + 32 <= root_dir.size(); offset += 32) {
+      const quint8 entry_type = Byte(root_dir, offset);
+      if (entry_type == 0x00) {
+        break;
+      }
+      if (entry_type != 0x81) {
+        continue;
+      }
+
+      const qint64 first_cluster = LittleEndian<quint32>(root_dir, offset + 20);
+      const qint64 data_length = LittleEndian<quint64>(root_dir, offset + 24);
+      qint64 used_clusters = 0;
+      if (first_cluster >= 2 && data_length * 8 >= cluster_count &&
+          file.countSetBits(cluster_heap_offset +
+                                (first_cluster - 2) * cluster_size,
+                            cluster_count, used_clusters)) {
+        freespace = (cluster_count - used_clusters) * cluster_size;
+        return true;
+      }
+      break;
+    }
+  }
+
+  if (percent_in_use <= 100) {
+    freespace = total * (100 - percent_in_use) / 100;
+    return true;
+  }
+
+  return false;
+}
+
+bool ReadNtfsSuperBlock(const QString& devicePath, qlonglong& freespace,
+                        qlonglong& total) {
+  const DeviceFile file(devicePath);
+  QByteArray bs;
+  if (!file.read(0, 512, bs) || !IsNtfsBootSector(bs)) {
+    return false;
+  }
+
+  const qint64 bytes_per_sector = LittleEndian<quint16>(bs, 11);
+  const quint8 sectors_per_cluster_value = Byte(bs, 13);
+  const qint64 sectors_per_cluster = sectors_per_cluster_value <= 0x80 ?
+      sectors_per_cluster_value : 1LL << (256 - sectors_per_cluster_value);
+  const qint64 cluster_size = bytes_per_sector * sectors_per_cluster;
+  const qint64 total_sectors = LittleEndian<quint64>(bs, 40);
+  const qint64 mft_cluster = LittleEndian<quint64>(bs, 48);
+  const qint8 clusters_per_record = static_cast<qint8>(Byte(bs, 64));
+  const qint64 record_size = clusters_per_record > 0 ?
+      clusters_per_record * cluster_size : 1LL << -clusters_per_record;
+  if (bytes_per_sector < 256 || cluster_size <= 0 || record_size < 512 ||
+      record_size > 64 * 1024) {
+    return false;
+  }
+
+  const qint64 total_clusters = total_sectors / sectors_per_cluster;
+  total = total_clusters * cluster_size;
+
+  // $Bitmap is record 6 of MFT, which is always in the first MFT extent.
+  QByteArray record;
+  if (!file.read(mft_cluster * cluster_size + 6 * record_size,
+                 static_cast<int>(record_size), record) ||
+      memcmp(record.constData(), "FILE", 4) != 0) {
+    return false;
+  }
+
+  // Apply update sequence, the last two bytes of each 512 bytes block are
+  // stored in the update sequence array.
+  const int usa_offset = LittleEndian<quint16>(record, 4);
+  const int usa_count = LittleEndian<quint16>(record, 6);
+  if (usa_offset + usa_count * 2 > record.size()) {
+    return false;
+  }
+  for (int i = 1; i < usa_count; ++i) {
+    const int position = i * 512 - 2;
+    if (position + 2 > record.size()) {
+      break;
+    }
+    if (memcmp(record.constData() + position,
+               record.constData() + usa_offset, 2) != 0) {
+      return false;
+    }
+    record[position] = record.at(usa_offset + i * 2);
+    record[position + 1] = record.at(usa_offset + i * 2 + 1);
+  }
+
+  // Find the unnamed non-resident $DATA attribute and decode its run list.
+  int offset = LittleEndian<quint16>(record, 20);
+  QList<QPair<qint64, qint64>> runs;
+  while (offset + 16 <= record.size()) {
+    const quint32 type = LittleEndian<quint32>(record, offset);
+    const int length = static_cast<int>(LittleEndian<quint32>(record, offset + 4));
+    if (type == 0xFFFFFFFF || length <= 0 || offset + length > record.size()) {
+      break;
+    }
+
+    if (type == 0x80 && Byte(record, offset + 8) != 0 &&
+        Byte(record, offset + 9) == 0 && length >= 64) {
+      int position = offset + LittleEndian<quint16>(record, offset + 32);
+      qint64 cluster = 0;
+      while (position < offset + length && Byte(record, position) != 0) {
+        const int length_size = Byte(record, position) & 0x0F;
+        const int offset_size = Byte(record, position) >> 4;
+        if (length_size == 0 || length_size > 8 || offset_size > 8 ||
+            position + 1 + length_size + offset_size > offset + length) {
+          return false;
+        }
+
+        qint64 run_length = 0;
+        for (int i = length_size - 1; i >= 0; --i) {
+          run_length = (run_length << 8) | Byte(record, position + 1 + i);
+        }
+        qint64 run_offset = 0;
+        for (int i = offset_size - 1; i >= 0; --i) {
+          run_offset = (run_offset << 8) |
+                       Byte(record, position + 1 + length_size + i);
+        }
+        // Sign extend.
+        if (offset_size > 0 && offset_size < 8 &&
+            (Byte(record, position + length_size + offset_size) & 0x80)) {
+          run_offset -= 1LL << (offset_size * 8);
+        }
+
+        cluster += run_offset;
+        runs.append(qMakePair(cluster, run_length));
+        position += 1 + length_size + offset_size;
+      }
+      break;
+    }
+
+    offset += length;
+  }
+
+  // Count used clusters in $Bitmap.
+  qint64 remaining_bits = total_clusters;
+  qint64 used_clusters = 0;
+  for (const QPair<qint64, qint64>& run : runs) {
+    if (remaining_bits <= 0) {
+      break;
+    }
+
+    const qint64 bits = qMin(remaining_bits, run.second * cluster_size * 8);
+    qint64 count = 0;
+    if (!file.countSetBits(run.first * cluster_size, bits, count)) {
+      return false;
+    }
+    used_clusters += count;
+    remaining_bits -= bits;
+  }
+
+  if (runs.isEmpty() || remaining_bits > 0) {
+    return false;
+  }
+
+  freespace = (total_clusters - used_clusters) * cluster_size;
+  return true;
+}
+
+}  // namespace PartMan
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *               2016 ~ 2018 dragondjf
+ *
+ * Author:     dragondjf<dingjiangfeng@deepin.com>
+ *
+ * Maintainer: dragondjf<dingjiangfeng@deepin.com>
+ *             zccrs<zhangjide@deepin.com>
+ *             Tangtong<tangtong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARTMAN_BLOCKDEVICE_H
+#define PARTMAN_BLOCKDEVICE_H
+
+#include <QString>
+
+namespace PartMan {
+
+// Identity of a block device, as reported by `lsblk`.
+struct BlockDeviceInfo {
+  QString name;
+  QString fs;
+  QString label;
+  QString uuid;
+  bool removable = false;
+};
+
+// Read identity of block device at |devicePath| from sysfs and udev database,
+// falls back to probing superblock if udev has no record of its filesystem.
+// Result is cached until udev updates its record of this device.
+// Returns false if |devicePath| is not a block device.
+bool ReadBlockDeviceInfo(const QString& devicePath, BlockDeviceInfo& info);
+
+// Returns mount point of |devicePath| in /proc/self/mountinfo, or an empty
+// string if it is not mounted.
+QString GetDeviceMountPoint(const QString& devicePath);
+
+// Returns file system type detected from superblock of |devicePath|, in the
+// same form as `blkid`, or an empty string if not recognized.
+QString ProbeFileSystem(const QString& devicePath);
+
+// Read usage of file system mounted at |mountPoint| with statvfs().
+bool ReadMountedUsage(const QString& mountPoint, qlonglong& freespace,
+                      qlonglong& total);
+
+// Read usage of file system at |devicePath| from its on-disk metadata,
+// without spawning any file system tools.
+bool ReadExtSuperBlock(const QString& devicePath, qlonglong& freespace,
+                       qlonglong& total);
+bool ReadBtrfsSuperBlock(const QString& devicePath, qlonglong& freespace,
+                         qlonglong& total);
+bool ReadXfsSuperBlock(const QString& devicePath, qlonglong& freespace,
+                       qlonglong& total);
+bool ReadFatSuperBlock(const QString& devicePath, qlonglong& freespace,
+                       qlonglong& total);
+bool ReadExfatSuperBlock(const QString& devicePath, qlonglong& freespace,
+                         qlonglong& total);
+bool ReadNtfsSuperBlock(const QString& devicePath, qlonglong& freespace,
+                        qlonglong& total);
+
+}  // namespace PartMan
+
+#endif  // PARTMAN_BLOCKDEVICE_H
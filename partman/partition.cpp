@@ -23,6 +23,7 @@
  */
 
 #include "partition.h"
+#include "blockdevice.h"
 #include "command.h"
 #include "readusagemanager.h"
 #include <QString>
@@ -34,6 +35,23 @@
 namespace PartMan {
 
 
+static void readPartitionUsage(Partition &p)
+{
+    if (p.fs().isEmpty()) {
+        return;
+    }
+
+    ReadUsageManager readUsageManager;
+    qlonglong freespace = 0;
+    qlonglong total = 0;
+    bool ret = readUsageManager.readUsage(p.path(), p.fs(), freespace, total);
+    if (ret) {
+        p.setFreespace(freespace);
+        p.setTotal(total);
+    }
+    qDebug() << "read usage of" << p.path() << ret;
+}
+
 Partition::Partition()
 {
 
@@ -43,6 +61,19 @@ Partition Partition::getPartitionByDevicePath(const QString &devicePath)
 {
     Partition p;
     p.setPath(devicePath);
+
+    BlockDeviceInfo info;
+    if (ReadBlockDeviceInfo(devicePath, info)) {
+        p.setName(info.name);
+        p.setFs(info.fs);
+        p.setLabel(info.label);
+        p.setUuid(info.uuid);
+        p.setMountPoint(GetDeviceMountPoint(devicePath));
+        p.setIsRemovable(info.removable);
+        readPartitionUsage(p);
+        return p;
+    }
+
     QString output;
     QString err;
 
@@ -79,17 +110,7 @@ Partition Partition::getPartitionByDevicePath(const QString &devicePath)
                             p.setIsRemovable(false);
                     }
 
-                    if (!p.fs().isEmpty()){
-                        ReadUsageManager readUsageManager;
-                        qlonglong freespace = 0;
-                        qlonglong total = 0;
-                        bool ret = readUsageManager.readUsage(p.path(), p.fs(), freespace, total);
-                        if (ret){
-                            p.setFreespace(freespace);
-                            p.setTotal(total);
-                        }
-                        qDebug() << "read usage of" << p.path() << ret;
-                    }
+                    readPartitionUsage(p);
                 }
             }
         }else{
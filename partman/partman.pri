@@ -1,6 +1,7 @@
 QT       += dbus
 
 HEADERS += \
+    $$PWD/blockdevice.h \
     $$PWD/command.h \
     $$PWD/partitionmanager.h \
     $$PWD/partition.h \
@@ -9,6 +10,7 @@ HEADERS += \
     $$PWD/readusagemanager.h
 
 SOURCES += \
+    $$PWD/blockdevice.cpp \
     $$PWD/command.cpp \
     $$PWD/partitionmanager.cpp \
     $$PWD/partition.cpp \
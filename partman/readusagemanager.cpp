@@ -23,6 +23,7 @@
  */
 
 #include "readusagemanager.h"
+#include "blockdevice.h"
 #include "string_util.h"
 #include "structs.h"
 #include "command.h"
@@ -65,6 +66,10 @@ bool ReadUsageManager::readUsage(const QString &path, qlonglong &freespace, qlon
     qDebug() << "Start read usage of " << path;
     freespace = 0;
     total = 0;
+    BlockDeviceInfo info;
+    if (ReadBlockDeviceInfo(path, info)) {
+        return readUsage(path, info.fs, freespace, total);
+    }
     Partition p = Partition::getPartitionByDevicePath(path);
     return readUsage(path, p.fs(), freespace, total);
 }
@@ -74,6 +79,13 @@ bool ReadUsageManager::readUsage(const QString &path, const QString &fs, qlonglo
     if (fs.isEmpty()){
         return false;
     }
+
+    // mounted file systems report their usage directly
+    const QString &mountPoint = GetDeviceMountPoint(path);
+    if (!mountPoint.isEmpty() && ReadMountedUsage(mountPoint, freespace, total)) {
+        return true;
+    }
+
     QString _fs = fs;
     if (_fs == "vfat")
          _fs = "fat16";
@@ -105,6 +117,10 @@ bool ReadUsageManager::readUsage(const QString &path, const QString &fs, qlonglo
 
 bool ReadUsageManager::readBtrfsUsage(const QString &path, qlonglong &freespace, qlonglong &total)
 {
+    if (ReadBtrfsSuperBlock(path, freespace, total)) {
+        return true;
+    }
+
     QString output;
     if (!SpawnCmd("btrfs", {"filesystem", "show", path}, output)) {
         return false;
@@ -129,6 +145,10 @@ bool ReadUsageManager::readEfiUsage(const QString &path, qlonglong &freespace, q
 
 bool ReadUsageManager::readExt2Usage(const QString &path, qlonglong &freespace, qlonglong &total)
 {
+    if (ReadExtSuperBlock(path, freespace, total)) {
+        return true;
+    }
+
     QString output;
     if (!SpawnCmd("dumpe2fs", {"-h", path}, output)) {
         return false;
@@ -170,6 +190,11 @@ bool ReadUsageManager::readExt4Usage(const QString &path, qlonglong &freespace,
     return readExt2Usage(path, freespace, total);
 }
 
+bool ReadUsageManager::readExfatUsage(const QString &path, qlonglong &freespace, qlonglong &total)
+{
+    return ReadExfatSuperBlock(path, freespace, total);
+}
+
 bool ReadUsageManager::readF2fsUsage(const QString &path, qlonglong &freespace, qlonglong &total)
 {
     qDebug() << "unsupport F2fs fs type usage read";
@@ -178,6 +203,10 @@ bool ReadUsageManager::readF2fsUsage(const QString &path, qlonglong &freespace,
 
 bool ReadUsageManager::readFat16Usage(const QString &path, qlonglong &freespace, qlonglong &total)
 {
+    if (ReadFatSuperBlock(path, freespace, total)) {
+        return true;
+    }
+
     QString output, err;
     SpawnCmd("dosfsck", {"-n", "-v", path}, output, err);
       // NOTE(xushaohua): `dosfsck` returns 1 on success, so we check its error
@@ -300,6 +329,10 @@ bool ReadUsageManager::readNilfs2Usage(const QString &path, qlonglong &freespace
 
 bool ReadUsageManager::readNtfsUsage(const QString &path, qlonglong &freespace, qlonglong &total)
 {
+    if (ReadNtfsSuperBlock(path, freespace, total)) {
+        return true;
+    }
+
     QString output;
     if (!SpawnCmd("ntfsinfo", {"-mf", path}, output)) {
         return false;
@@ -396,6 +429,10 @@ bool ReadUsageManager::readReiserfsUsage(const QString &path, qlonglong &freespa
 
 bool ReadUsageManager::readXfsUsage(const QString &path, qlonglong &freespace, qlonglong &total)
 {
+    if (ReadXfsSuperBlock(path, freespace, total)) {
+        return true;
+    }
+
     QString output;
     if (!SpawnCmd("xfs_db", {"-c sb", "-c print", "-r", path}, output)) {
         return false;
@@ -47,6 +47,7 @@ public slots:
     bool readExt2Usage(const QString& path, qlonglong& freespace, qlonglong& total);
     bool readExt3Usage(const QString& path, qlonglong& freespace, qlonglong& total);
     bool readExt4Usage(const QString& path, qlonglong& freespace, qlonglong& total);
+    bool readExfatUsage(const QString& path, qlonglong& freespace, qlonglong& total);
     bool readF2fsUsage(const QString& path, qlonglong& freespace, qlonglong& total);
     bool readFat16Usage(const QString& path, qlonglong& freespace, qlonglong& total);
     bool readFat32Usage(const QString& path, qlonglong& freespace, qlonglong& total);